@@ -1,8 +1,6 @@
 
 // Input
 layout (location = 0) in vec2 textureCoordsIn;
-layout (location = 1) in flat int renderOptions;
-
 layout (location = 2) in flat int materialIdx;
 
 
@@ -23,29 +21,25 @@ void main()
 {
   Material material = materials[materialIdx];
 
-  if(bool(renderOptions & RENDERING_OPTION_FONT))
-  {
-    vec4 textureColor = texelFetch(fontAtlas, ivec2(textureCoordsIn), 0);
-
+  // Text and sprites are drawn with different variants, see SHADER_VARIANT_FONT
+#ifdef VARIANT_FONT
+  vec4 textureColor = texelFetch(fontAtlas, ivec2(textureCoordsIn), 0);
 
-    if(textureColor.r == 0.0)
-    {
-      discard;
-    }
-
-    fragColor = textureColor.r * material.color;
-  }
-  else
+  if(textureColor.r == 0.0)
   {
-    vec4 textureColor = texelFetch(textureAtlas, ivec2(textureCoordsIn), 0);
-
-    if(textureColor.a == 0.0)
-    {
-      discard;
-    }
+    discard;
+  }
 
+  fragColor = textureColor.r * material.color;
+#else
+  vec4 textureColor = texelFetch(textureAtlas, ivec2(textureCoordsIn), 0);
 
-    fragColor = textureColor * material.color;
+  if(textureColor.a == 0.0)
+  {
+    discard;
   }
 
+  fragColor = textureColor * material.color;
+#endif
+
 }
\ No newline at end of file
@@ -3,46 +3,62 @@
 
 // Output
 layout (location = 0) out vec2 textureCoordsOut;
-layout (location = 1) out flat int renderOptions;
 layout (location = 2) out flat int materialIdx;
 
 // Buffers
 
 layout (std430, binding = 0) buffer TransformSBO
 {
-  Transform transforms[];
+  InstanceData transforms[];
 }
 
-uniform vec2 screenSize;
 uniform mat4 orthoProjection;
+uniform vec2 instanceOrigin; // Instance positions are relative to this
 
 
 
+#ifdef COMPACT_TRANSFORMS
+Transform unpack_transform(PackedTransform packedTransform)
+{
+  float scale = 1.0 / float(1 << TRANSFORM_FRACTION_BITS);
+
+  Transform transform;
+  transform.pos = vec2(bitfieldExtract(int(packedTransform.pos), 0, 16), 
+                       bitfieldExtract(int(packedTransform.pos), 16, 16)) * scale;
+  transform.size = vec2(packedTransform.size & 0xFFFFu, packedTransform.size >> 16) * scale;
+  transform.atlasOffset = ivec2(packedTransform.atlasOffset & 0xFFFFu, packedTransform.atlasOffset >> 16);
+  transform.spriteSize = ivec2(packedTransform.spriteSize & 0xFFFFu, packedTransform.spriteSize >> 16);
+  transform.renderOptions = int(packedTransform.packedData & 0xFFu);
+  transform.layer = float((packedTransform.packedData >> 8) & 0xFFu) / 255.0;
+  transform.materialIdx = int(packedTransform.packedData >> 16);
+
+  return transform;
+}
+#endif
+
 void main()
 {
+#ifdef COMPACT_TRANSFORMS
+  Transform transform = unpack_transform(transforms[gl_InstanceID]);
+#else
   Transform transform = transforms[gl_InstanceID];
+#endif
 
   // Generating Vertices on the GPU
   // mostly because we have a 2D Engine
 
-  // OpenGL Coordinates
-  // -1/ 1                1/ 1
-  // -1/-1                1/-1
-  vec2 vertices[6] =
-  {
-    transform.pos,                                        // Top Left
-    vec2(transform.pos + vec2(0.0, transform.size.y)),    // Bottom Left
-    vec2(transform.pos + vec2(transform.size.x, 0.0)),    // Top Right
-    vec2(transform.pos + vec2(transform.size.x, 0.0)),    // Top Right
-    vec2(transform.pos + vec2(0.0, transform.size.y)),    // Bottom Left
-    transform.pos + transform.size                        // Bottom Right
-  };
+  // 4 Vertices per quad, drawn with a shared index buffer
+  // 0 Top Left     1 Top Right
+  // 2 Bottom Left  3 Bottom Right
+  ivec2 corner = ivec2(gl_VertexID & 1, gl_VertexID >> 1);
 
   int left = transform.atlasOffset.x;
   int top = transform.atlasOffset.y;
   int right = transform.atlasOffset.x + transform.spriteSize.x;
   int bottom = transform.atlasOffset.y + transform.spriteSize.y;
 
+  // Only the flip variant checks the flags, see SHADER_VARIANT_FLIP
+#ifdef VARIANT_FLIP
   if(bool(transform.renderOptions & RENDERING_OPTION_FLIP_X))
   {
     int tmp = left;
@@ -56,27 +72,17 @@ void main()
     top = bottom;
     bottom = tmp;
   }
+#endif
+
+  vec2 textureCoords = vec2(corner.x == 1? right : left, corner.y == 1? bottom : top);
 
-  vec2 textureCoords[6] = 
-  {
-    vec2(left, top),
-    vec2(left, bottom),
-    vec2(right, top),
-    vec2(right, top),
-    vec2(left, bottom),
-    vec2(right, bottom),
-  };
- 
   // Normalize Position
   {
-    vec2 vertexPos = vertices[gl_VertexID];
-    // vertexPos.y = -vertexPos.y + screenSize.y;
-    // vertexPos = 2.0 * (vertexPos / screenSize) - 1.0;
+    vec2 vertexPos = transform.pos + vec2(corner) * transform.size + instanceOrigin;
     gl_Position = orthoProjection * vec4(vertexPos, transform.layer, 1.0);
   }
 
-  textureCoordsOut = textureCoords[gl_VertexID];
-  renderOptions = transform.renderOptions;
+  textureCoordsOut = textureCoords;
   materialIdx = transform.materialIdx;
 }
 
@@ -0,0 +1,34 @@
+// Input
+layout (location = 0) in vec2 tileMapPosIn;
+
+// Output
+layout (location = 0) out vec4 fragColor;
+
+// Bindings, binding = 0 binds to GL_TEXTURE0, binding = 2 binds to GL_TEXTURE2, etc.
+layout (binding = 0) uniform sampler2D textureAtlas;
+layout (binding = 2) uniform usampler2D tileMap;
+
+uniform ivec2 tileMapSize;
+uniform ivec2 tileMapOffset; // The map scrolls without moving the stored tiles
+uniform int tileSize;
+uniform ivec2 tileAtlasCoords[MAX_TILEMAP_ATLAS_COORDS];
+
+void main()
+{
+  ivec2 tilePos = (min(ivec2(tileMapPosIn), tileMapSize - 1) + tileMapOffset) % tileMapSize;
+  uint tileValue = texelFetch(tileMap, tilePos, 0).r;
+  if(tileValue == uint(TILEMAP_EMPTY_TILE))
+  {
+    discard;
+  }
+
+  ivec2 pixel = min(ivec2(fract(tileMapPosIn) * float(tileSize)), ivec2(tileSize - 1));
+  vec4 textureColor = texelFetch(textureAtlas, tileAtlasCoords[tileValue] + pixel, 0);
+
+  if(textureColor.a == 0.0)
+  {
+    discard;
+  }
+
+  fragColor = textureColor;
+}
@@ -0,0 +1,18 @@
+// Output
+layout (location = 0) out vec2 tileMapPosOut; // In Tiles
+
+uniform mat4 orthoProjection;
+uniform vec2 tileMapPos;
+uniform ivec2 tileMapSize;
+uniform int tileSize;
+
+void main()
+{
+  // One quad covering the whole Tile Map, same corners as quad.vert
+  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+  vec2 vertexPos = tileMapPos + corner * vec2(tileMapSize * tileSize);
+  gl_Position = orthoProjection * vec4(vertexPos, 0.0, 1.0);
+
+  tileMapPosOut = corner * vec2(tileMapSize);
+}
@@ -4,21 +4,52 @@ timestamp=$(date +%s)
 
 
 defines="-DENGINE"
-libs="-luser32 -lopengl32 -lgdi32"
+libs="-luser32 -lopengl32 -lgdi32 -lwinmm"
+executable="breakout.exe"
+libExtension="dll"
+libFlags=""
 
 warnings="-Wno-writable-strings -Wno-format-security -Wno-deprecated-declarations -Wno-switch"
 includes="-Ithird_party -Ithird_party/Include"
 
-clang++ $includes -g src/main.cpp -obreakout.exe $libs $warnings $defines
+# Linux builds the headless platform (no window, no GPU), used for benchmarks
+if [[ "$(uname)" == "Linux" ]]; then
+  libs="-ldl -lfreetype"
+  executable="breakout"
+  libExtension="so"
+  libFlags="-fPIC" # Position independent code, required for .so files
+fi
+
+clang++ $includes -g src/main.cpp -o$executable $libs $warnings $defines
+
+# Autotiling test, replays random edits on the headless platform. The game is built
+# with AUTOTILE_SELF_CHECK, so after every edit the incremental masks are compared
+# against compute_chunk_neighbour_masks() and a mismatch stops the run
+if [[ "$(uname)" == "Linux" ]]; then
+  clang++ -g "src/game.cpp" -shared $libFlags -o game.$libExtension $warnings $defines -DAUTOTILE_SELF_CHECK
+
+  testSaveDirectory=$(mktemp -d)
+  BREAKOUT_HEADLESS_SCRIPT=random_edits BREAKOUT_HEADLESS_FRAMES=14000 \
+  BREAKOUT_SAVE_DIRECTORY=$testSaveDirectory ./$executable > autotile_test.log
+  testResult=$?
+  rm -rf $testSaveDirectory
+
+  if [[ $testResult -ne 0 ]]; then
+    grep "ERROR" autotile_test.log
+    echo "Autotiling test failed, see autotile_test.log"
+    exit 1
+  fi
+  echo "Autotiling test passed"
+fi
 
 rm -f game_* # remove old game files
 
-# Compile the game.cpp source file into a shared library (.dll)
+# Compile the game.cpp source file into a shared library (.dll / .so)
 # -g: Include debugging information
 # -shared: Create a shared library
 # -o game_$timestamp.dll: Output file named with a timestamp
-clang++ -g "src/game.cpp" -shared -o game_$timestamp.dll $warnings $defines
+clang++ -g "src/game.cpp" -shared $libFlags -o game_$timestamp.$libExtension $warnings $defines
 
-# Rename the newly created .dll file to game.dll
+# Rename the newly created library to game.dll / game.so
 # This ensures that the game always loads the latest version
-mv game_$timestamp.dll game.dll
\ No newline at end of file
+mv game_$timestamp.$libExtension game.$libExtension
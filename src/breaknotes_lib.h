@@ -11,9 +11,39 @@
 // Used to get the edit timestamp of files
 #include <sys/stat.h>
 
+// Error codes of file operations
+#include <errno.h>
+
+// Virtual Memory for the BumpAllocator
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>  // Also used to map files
+#include <unistd.h>
+#endif
+
 // Obvious right?
 #include <math.h>
 
+// Fixed size integer limits, used to pack values
+#include <stdint.h>
+
+// Lock free data exchange between threads
+#include <atomic>
+
+// Log thread, deferred formatting of log arguments
+#include <thread>
+#include <chrono>
+#include <tuple>
+#include <type_traits>
+
 // #############################################################################
 //                           Constants
 // #############################################################################
@@ -28,7 +58,11 @@ constexpr int SAMPLE_RATE = 44100;
 #define DEBUG_BREAK() __debugbreak()
 #define EXPORT_FN __declspec(dllexport)
 #elif __linux__
+#ifdef __clang__
 #define DEBUG_BREAK() __builtin_debugtrap()
+#else
+#define DEBUG_BREAK() __builtin_trap()
+#endif
 #define EXPORT_FN
 #elif __APPLE__
 #define DEBUG_BREAK() __builtin_trap()
@@ -68,50 +102,301 @@ enum TextColor
   TEXT_COLOR_COUNT
 };
 
+static char* TextColorTable[TEXT_COLOR_COUNT] = 
+{    
+  "\x1b[30m", // TEXT_COLOR_BLACK
+  "\x1b[31m", // TEXT_COLOR_RED
+  "\x1b[32m", // TEXT_COLOR_GREEN
+  "\x1b[33m", // TEXT_COLOR_YELLOW
+  "\x1b[34m", // TEXT_COLOR_BLUE
+  "\x1b[35m", // TEXT_COLOR_MAGENTA
+  "\x1b[36m", // TEXT_COLOR_CYAN
+  "\x1b[37m", // TEXT_COLOR_WHITE
+  "\x1b[90m", // TEXT_COLOR_BRIGHT_BLACK
+  "\x1b[91m", // TEXT_COLOR_BRIGHT_RED
+  "\x1b[92m", // TEXT_COLOR_BRIGHT_GREEN
+  "\x1b[93m", // TEXT_COLOR_BRIGHT_YELLOW
+  "\x1b[94m", // TEXT_COLOR_BRIGHT_BLUE
+  "\x1b[95m", // TEXT_COLOR_BRIGHT_MAGENTA
+  "\x1b[96m", // TEXT_COLOR_BRIGHT_CYAN
+  "\x1b[97m", // TEXT_COLOR_BRIGHT_WHITE
+};
+
+enum LogLevel
+{
+  LOG_LEVEL_TRACE,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_ERROR,
+};
+
+// Every message gets a fixed size slot, the arguments are copied in raw
+// and only formatted on the log thread. Strings are copied as well,
+// because they might not be alive anymore once the message is formatted.
+constexpr int LOG_QUEUE_SIZE = 1024; // Has to be a power of 2
+constexpr int LOG_PAYLOAD_SIZE = 256;
+
+struct LogEntry;
+typedef void (log_format_type)(LogEntry* entry, char* buffer, int bufferSize);
+
+struct LogEntry
+{
+  std::atomic<unsigned int> sequence;
+  log_format_type* format;
+  char* prefix;
+  char* msg;
+  TextColor textColor;
+  char payload[LOG_PAYLOAD_SIZE];
+};
+
+// Bounded multi producer, single consumer queue (Dmitry Vyukov's design),
+// any thread can log, the log thread consumes
+struct Logger
+{
+  LogEntry entries[LOG_QUEUE_SIZE];
+  std::atomic<unsigned int> enqueuePos;
+  unsigned int dequeuePos; // Log thread only
+
+  std::atomic<int> minLevel;
+  std::atomic<unsigned int> droppedCount;  // Queue was full
+  std::atomic<unsigned int> filteredCount; // Below minLevel
+
+  std::atomic<bool> running;
+  std::thread thread;
+};
+
+// Only the engine starts the log thread, until then (and inside the
+// game library) messages are formatted and written right away
+static Logger logger;
+
+template <typename T>
+void log_pack(char*& ptr, char* end, T value)
+{
+  if constexpr(std::is_same_v<T, char*> || std::is_same_v<T, const char*>)
+  {
+    const char* str = value? value : "(null)";
+    if(ptr < end)
+    {
+      int length = (int)strlen(str);
+      if(length > end - ptr - 1)
+      {
+        length = (int)(end - ptr - 1);
+      }
+
+      memcpy(ptr, str, length);
+      ptr[length] = 0;
+      ptr += length + 1;
+    }
+  }
+  else
+  {
+    if(ptr + sizeof(T) <= end)
+    {
+      memcpy(ptr, &value, sizeof(T));
+    }
+    ptr += sizeof(T);
+  }
+}
+
+template <typename T>
+T log_unpack(char*& ptr, char* end)
+{
+  if constexpr(std::is_same_v<T, char*> || std::is_same_v<T, const char*>)
+  {
+    if(ptr >= end)
+    {
+      return (T)"";
+    }
+
+    char* str = ptr;
+    ptr += strlen(str) + 1;
+    return str;
+  }
+  else
+  {
+    T value = {};
+    if(ptr + sizeof(T) <= end)
+    {
+      memcpy(&value, ptr, sizeof(T));
+    }
+    ptr += sizeof(T);
+    return value;
+  }
+}
+
 template <typename ...Args>
-void _log(char* prefix, char* msg, TextColor textColor, Args... args)
-{
-  static char* TextColorTable[TEXT_COLOR_COUNT] = 
-  {    
-    "\x1b[30m", // TEXT_COLOR_BLACK
-    "\x1b[31m", // TEXT_COLOR_RED
-    "\x1b[32m", // TEXT_COLOR_GREEN
-    "\x1b[33m", // TEXT_COLOR_YELLOW
-    "\x1b[34m", // TEXT_COLOR_BLUE
-    "\x1b[35m", // TEXT_COLOR_MAGENTA
-    "\x1b[36m", // TEXT_COLOR_CYAN
-    "\x1b[37m", // TEXT_COLOR_WHITE
-    "\x1b[90m", // TEXT_COLOR_BRIGHT_BLACK
-    "\x1b[91m", // TEXT_COLOR_BRIGHT_RED
-    "\x1b[92m", // TEXT_COLOR_BRIGHT_GREEN
-    "\x1b[93m", // TEXT_COLOR_BRIGHT_YELLOW
-    "\x1b[94m", // TEXT_COLOR_BRIGHT_BLUE
-    "\x1b[95m", // TEXT_COLOR_BRIGHT_MAGENTA
-    "\x1b[96m", // TEXT_COLOR_BRIGHT_CYAN
-    "\x1b[97m", // TEXT_COLOR_BRIGHT_WHITE
-  };
+void log_format(char* buffer, int bufferSize, char* prefix, char* msg, TextColor textColor, Args... args)
+{
+  char formatBuffer[1024] = {};
+  snprintf(formatBuffer, sizeof(formatBuffer), "%s %s %s \033[0m", TextColorTable[textColor], prefix, msg);
+  snprintf(buffer, bufferSize, formatBuffer, args...);
+}
 
-  char formatBuffer[8192] = {};
-  sprintf(formatBuffer, "%s %s %s \033[0m", TextColorTable[textColor], prefix, msg);
+template <typename ...Args>
+void log_format_entry(LogEntry* entry, char* buffer, int bufferSize)
+{
+  char* ptr = entry->payload;
+  char* end = entry->payload + LOG_PAYLOAD_SIZE;
 
-  char textBuffer[8912] = {};
-  sprintf(textBuffer, formatBuffer, args...);
+  // Braced initialization unpacks the arguments in order
+  std::tuple<Args...> args{log_unpack<Args>(ptr, end)...};
+  std::apply([&](auto... unpacked)
+  {
+    log_format(buffer, bufferSize, entry->prefix, entry->msg, entry->textColor, unpacked...);
+  }, args);
+}
 
+// Formats and writes the message on the calling thread
+template <typename ...Args>
+void _log_now(char* prefix, char* msg, TextColor textColor, Args... args)
+{
+  char textBuffer[8192];
+  log_format(textBuffer, sizeof(textBuffer), prefix, msg, textColor, args...);
   puts(textBuffer);
+
+  // SM_ASSERT breaks right after, the message must not wait in a buffer
+  fflush(stdout);
 }
 
-#define SM_TRACE(msg, ...) _log("TRACE: ", msg, TEXT_COLOR_GREEN, ##__VA_ARGS__);
-#define SM_WARN(msg, ...) _log("WARN: ", msg, TEXT_COLOR_YELLOW, ##__VA_ARGS__);
-#define SM_ERROR(msg, ...) _log("ERROR: ", msg, TEXT_COLOR_RED, ##__VA_ARGS__);
+template <typename ...Args>
+void _log(LogLevel level, char* prefix, char* msg, TextColor textColor, Args... args)
+{
+  if(level < logger.minLevel.load(std::memory_order_relaxed))
+  {
+    logger.filteredCount.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  if(!logger.running.load(std::memory_order_acquire))
+  {
+    _log_now(prefix, msg, textColor, args...);
+    return;
+  }
 
-#define SM_ASSERT(x, msg, ...)    \
-{                                 \
-  if(!(x))                        \
-  {                               \
-    SM_ERROR(msg, ##__VA_ARGS__); \
-    DEBUG_BREAK();                \
-    SM_ERROR("Assertion HIT!")    \
-  }                               \
+  // Claim a slot
+  LogEntry* entry = nullptr;
+  unsigned int pos = logger.enqueuePos.load(std::memory_order_relaxed);
+  while(true)
+  {
+    entry = &logger.entries[pos & (LOG_QUEUE_SIZE - 1)];
+    int diff = (int)(entry->sequence.load(std::memory_order_acquire) - pos);
+    if(diff == 0)
+    {
+      if(logger.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if(diff < 0)
+    {
+      // Full, the log thread can't keep up
+      logger.droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    else
+    {
+      pos = logger.enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  entry->format = log_format_entry<Args...>;
+  entry->prefix = prefix;
+  entry->msg = msg;
+  entry->textColor = textColor;
+  char* ptr = entry->payload;
+  // Arguments that don't fit are formatted as 0 / empty strings
+  (log_pack(ptr, entry->payload + LOG_PAYLOAD_SIZE, args), ...);
+
+  entry->sequence.store(pos + 1, std::memory_order_release);
+}
+
+// Formats everything that is queued, returns how many messages were written
+int log_drain()
+{
+  char textBuffer[8192];
+  int written = 0;
+
+  while(true)
+  {
+    LogEntry* entry = &logger.entries[logger.dequeuePos & (LOG_QUEUE_SIZE - 1)];
+    if(entry->sequence.load(std::memory_order_acquire) != logger.dequeuePos + 1)
+    {
+      break;
+    }
+
+    entry->format(entry, textBuffer, sizeof(textBuffer));
+    puts(textBuffer);
+    written++;
+
+    entry->sequence.store(logger.dequeuePos + LOG_QUEUE_SIZE, std::memory_order_release);
+    logger.dequeuePos++;
+  }
+
+  static unsigned int reportedDroppedCount;
+  unsigned int droppedCount = logger.droppedCount.load(std::memory_order_relaxed);
+  if(droppedCount != reportedDroppedCount)
+  {
+    _log_now("WARN: ", "Logger dropped %u messages, %u in total", TEXT_COLOR_YELLOW,
+             droppedCount - reportedDroppedCount, droppedCount);
+    reportedDroppedCount = droppedCount;
+  }
+
+  if(written)
+  {
+    fflush(stdout);
+  }
+
+  return written;
+}
+
+void log_thread()
+{
+  while(logger.running.load(std::memory_order_acquire))
+  {
+    if(!log_drain())
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  log_drain();
+}
+
+// Writes out everything that is still queued
+void stop_log_thread()
+{
+  if(logger.running.exchange(false))
+  {
+    logger.thread.join();
+  }
+}
+
+void start_log_thread(LogLevel minLevel = LOG_LEVEL_TRACE)
+{
+  for(int entryIdx = 0; entryIdx < LOG_QUEUE_SIZE; entryIdx++)
+  {
+    logger.entries[entryIdx].sequence.store(entryIdx, std::memory_order_relaxed);
+  }
+  logger.minLevel = minLevel;
+  logger.running.store(true, std::memory_order_release);
+  logger.thread = std::thread(log_thread);
+
+  // Everything still queued gets written on exit
+  atexit(stop_log_thread);
+}
+
+#define SM_TRACE(msg, ...) _log(LOG_LEVEL_TRACE, "TRACE: ", msg, TEXT_COLOR_GREEN, ##__VA_ARGS__);
+#define SM_WARN(msg, ...) _log(LOG_LEVEL_WARN, "WARN: ", msg, TEXT_COLOR_YELLOW, ##__VA_ARGS__);
+#define SM_ERROR(msg, ...) _log(LOG_LEVEL_ERROR, "ERROR: ", msg, TEXT_COLOR_RED, ##__VA_ARGS__);
+
+// Written right away, the program might not survive the break
+#define SM_ASSERT(x, msg, ...)                                 \
+{                                                              \
+  if(!(x))                                                     \
+  {                                                            \
+    _log_now("ERROR: ", msg, TEXT_COLOR_RED, ##__VA_ARGS__);   \
+    DEBUG_BREAK();                                             \
+    _log_now("ERROR: ", "Assertion HIT!", TEXT_COLOR_RED);     \
+  }                                                            \
 }
 
 // #############################################################################
@@ -156,14 +441,134 @@ struct Array
   }
 };
 
+// #############################################################################
+//                           Radix Sort
+// #############################################################################
+// LSD radix sort, 8 Bits per pass, stable. Passes where all keys share
+// the same byte are skipped. Returns keys or temp, whichever holds the result
+uint64_t* radix_sort(uint64_t* keys, uint64_t* temp, int count)
+{
+  if(count <= 0)
+  {
+    return keys;
+  }
+
+  for(int shift = 0; shift < 64; shift += 8)
+  {
+    int offsets[256] = {};
+    for(int idx = 0; idx < count; idx++)
+    {
+      offsets[(keys[idx] >> shift) & 0xFF]++;
+    }
+
+    if(offsets[(keys[0] >> shift) & 0xFF] == count)
+    {
+      continue;
+    }
+
+    int offset = 0;
+    for(int digit = 0; digit < 256; digit++)
+    {
+      int digitCount = offsets[digit];
+      offsets[digit] = offset;
+      offset += digitCount;
+    }
+
+    for(int idx = 0; idx < count; idx++)
+    {
+      temp[offsets[(keys[idx] >> shift) & 0xFF]++] = keys[idx];
+    }
+
+    uint64_t* sorted = temp;
+    temp = keys;
+    keys = sorted;
+  }
+
+  return keys;
+}
+
+// #############################################################################
+//                           Hashing
+// #############################################################################
+// FNV-1a, 64 Bit. Pass the previous result back in to hash several buffers as one
+uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+  const unsigned char* bytes = (const unsigned char*)data;
+  for(size_t byteIdx = 0; byteIdx < size; byteIdx++)
+  {
+    hash = (hash ^ bytes[byteIdx]) * 1099511628211ull;
+  }
+
+  return hash;
+}
+
+// #############################################################################
+//                           Triple Buffer
+// #############################################################################
+// Lock free exchange between exactly one producer and one consumer thread.
+// The producer always has a buffer to write into, the consumer always
+// reads the newest published one, neither ever waits on the other.
+template<typename T>
+struct TripleBuffer
+{
+  static constexpr int NEW_DATA_BIT = BIT(2);
+
+  T* buffers[3];
+  int writeIdx = 0;             // Producer only
+  int readIdx = 1;              // Consumer only
+  std::atomic<int> middleIdx{2}; // Shared, NEW_DATA_BIT is set when not yet consumed
+
+  T* write_buffer()
+  {
+    return buffers[writeIdx];
+  }
+
+  // Returns the buffer that was just published
+  T* publish()
+  {
+    int publishedIdx = writeIdx;
+    writeIdx = middleIdx.exchange(writeIdx | NEW_DATA_BIT, std::memory_order_acq_rel) & 3;
+    return buffers[publishedIdx];
+  }
+
+  T* read_buffer()
+  {
+    if(middleIdx.load(std::memory_order_relaxed) & NEW_DATA_BIT)
+    {
+      readIdx = middleIdx.exchange(readIdx, std::memory_order_acq_rel) & 3;
+    }
+
+    return buffers[readIdx];
+  }
+};
+
 // #############################################################################
 //                           Bump Allocator
 // #############################################################################
+// Flags for make_virtual_bump_allocator
+constexpr int BUMP_ALLOCATOR_GUARD_PAGE = BIT(0); // Overruns crash instead of corrupting memory
+constexpr int BUMP_ALLOCATOR_HUGE_PAGES = BIT(1); // Linux only, transparent huge pages
+
+// Memory is committed in steps of this size
+constexpr size_t BUMP_ALLOCATOR_COMMIT_SIZE = KB(64);
+constexpr size_t BUMP_ALLOCATOR_HUGE_COMMIT_SIZE = MB(2);
+
 struct BumpAllocator
 {
   size_t capacity;
   size_t used;
   char* memory;
+
+  // Virtual Memory, only the first `committed` bytes of `capacity` are backed
+  bool isVirtual;
+  size_t committed;
+  size_t commitSize;
+  size_t reserved; // Capacity + guard page
+
+  // Telemetry, used to size the arenas
+  size_t frameHighWaterMark;     // Highest `used` since the last frame reset
+  size_t lastFrameHighWaterMark; // Of the last completed frame
+  size_t highWaterMark;          // Highest `used` ever
 };
 
 BumpAllocator make_bump_allocator(size_t size)
@@ -174,6 +579,7 @@ BumpAllocator make_bump_allocator(size_t size)
   if(ba.memory)
   {
     ba.capacity = size;
+    ba.committed = size;
     memset(ba.memory, 0, size); // Sets the memory to 0
   }
   else
@@ -184,15 +590,93 @@ BumpAllocator make_bump_allocator(size_t size)
   return ba;
 }
 
+// Only reserves address space, pages get committed while the allocator
+// fills up. Fresh pages are zeroed by the OS, so no memset is needed.
+BumpAllocator make_virtual_bump_allocator(size_t size, int flags = 0)
+{
+  BumpAllocator ba = {};
+  ba.isVirtual = true;
+  ba.commitSize = (flags & BUMP_ALLOCATOR_HUGE_PAGES)? BUMP_ALLOCATOR_HUGE_COMMIT_SIZE :
+                                                       BUMP_ALLOCATOR_COMMIT_SIZE;
+  size = (size + ba.commitSize - 1) & ~(ba.commitSize - 1);
+
+  // The guard page is reserved but never committed
+  size_t reserveSize = size + ((flags & BUMP_ALLOCATOR_GUARD_PAGE)? ba.commitSize : 0);
+
+#ifdef _WIN32
+  ba.memory = (char*)VirtualAlloc(nullptr, reserveSize, MEM_RESERVE, PAGE_NOACCESS);
+#else
+  ba.memory = (char*)mmap(nullptr, reserveSize, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if(ba.memory == MAP_FAILED)
+  {
+    ba.memory = nullptr;
+  }
+
+#ifdef MADV_HUGEPAGE
+  if(ba.memory && (flags & BUMP_ALLOCATOR_HUGE_PAGES))
+  {
+    madvise(ba.memory, size, MADV_HUGEPAGE);
+  }
+#endif
+#endif
+
+  if(ba.memory)
+  {
+    ba.capacity = size;
+    ba.reserved = reserveSize;
+  }
+  else
+  {
+    SM_ASSERT(false, "Failed to reserve Memory!");
+  }
+
+  return ba;
+}
+
+// Commits memory up to at least `size` bytes
+bool bump_allocator_commit(BumpAllocator* bumpAllocator, size_t size)
+{
+  size_t commitEnd = (size + bumpAllocator->commitSize - 1) & ~(bumpAllocator->commitSize - 1);
+  commitEnd = commitEnd < bumpAllocator->capacity? commitEnd : bumpAllocator->capacity;
+
+  char* commitStart = bumpAllocator->memory + bumpAllocator->committed;
+  size_t commitBytes = commitEnd - bumpAllocator->committed;
+
+#ifdef _WIN32
+  bool commitResult = VirtualAlloc(commitStart, commitBytes, MEM_COMMIT, PAGE_READWRITE);
+#else
+  bool commitResult = mprotect(commitStart, commitBytes, PROT_READ | PROT_WRITE) == 0;
+#endif
+
+  if(commitResult)
+  {
+    bumpAllocator->committed = commitEnd;
+  }
+
+  return commitResult;
+}
+
 char* bump_alloc(BumpAllocator* bumpAllocator, size_t size)
 {
   char* result = nullptr;
 
   size_t allignedSize = (size + 7) & ~ 7; // This makes sure the first 4 bits are 0 
-  if(bumpAllocator->used + allignedSize <= bumpAllocator->capacity)
+  size_t newUsed = bumpAllocator->used + allignedSize;
+  if(newUsed <= bumpAllocator->capacity)
   {
+    if(newUsed > bumpAllocator->committed && !bump_allocator_commit(bumpAllocator, newUsed))
+    {
+      SM_ASSERT(false, "Failed to commit Memory");
+      return nullptr;
+    }
+
     result = bumpAllocator->memory + bumpAllocator->used;
-    bumpAllocator->used += allignedSize;
+    bumpAllocator->used = newUsed;
+    if(newUsed > bumpAllocator->frameHighWaterMark)
+    {
+      bumpAllocator->frameHighWaterMark = newUsed;
+    }
   }
   else
   {
@@ -202,6 +686,133 @@ char* bump_alloc(BumpAllocator* bumpAllocator, size_t size)
   return result;
 }
 
+// Frees everything and records the high water marks of the frame
+void bump_allocator_reset(BumpAllocator* bumpAllocator)
+{
+  bumpAllocator->lastFrameHighWaterMark = bumpAllocator->frameHighWaterMark;
+  if(bumpAllocator->frameHighWaterMark > bumpAllocator->highWaterMark)
+  {
+    bumpAllocator->highWaterMark = bumpAllocator->frameHighWaterMark;
+  }
+
+  bumpAllocator->frameHighWaterMark = 0;
+  bumpAllocator->used = 0;
+}
+
+// Gives the memory back to the OS
+void bump_allocator_release(BumpAllocator* bumpAllocator)
+{
+  if(!bumpAllocator->memory)
+  {
+    return;
+  }
+
+  if(bumpAllocator->isVirtual)
+  {
+#ifdef _WIN32
+    VirtualFree(bumpAllocator->memory, 0, MEM_RELEASE);
+#else
+    munmap(bumpAllocator->memory, bumpAllocator->reserved);
+#endif
+  }
+  else
+  {
+    free(bumpAllocator->memory);
+  }
+
+  *bumpAllocator = {};
+}
+
+// #############################################################################
+//                           Temporary Memory
+// #############################################################################
+// Everything allocated between begin and end is freed again on end,
+// scopes have to be ended in reverse order (like a stack)
+struct TempMemory
+{
+  BumpAllocator* bumpAllocator;
+  size_t used;
+};
+
+TempMemory begin_temp_memory(BumpAllocator* bumpAllocator)
+{
+  TempMemory tempMemory = {bumpAllocator, bumpAllocator->used};
+  return tempMemory;
+}
+
+void end_temp_memory(TempMemory tempMemory)
+{
+  SM_ASSERT(tempMemory.bumpAllocator->used >= tempMemory.used,
+            "Temporary Memory ended out of order");
+  tempMemory.bumpAllocator->used = tempMemory.used;
+}
+
+// Restores the allocator when it goes out of scope
+struct ScopedTempMemory
+{
+  TempMemory tempMemory;
+
+  ScopedTempMemory(BumpAllocator* bumpAllocator)
+  {
+    tempMemory = begin_temp_memory(bumpAllocator);
+  }
+
+  ~ScopedTempMemory()
+  {
+    end_temp_memory(tempMemory);
+  }
+
+  ScopedTempMemory(const ScopedTempMemory&) = delete;
+  ScopedTempMemory& operator=(const ScopedTempMemory&) = delete;
+};
+
+// #############################################################################
+//                           Scratch Arenas
+// #############################################################################
+// Every thread gets its own scratch arenas, created on first use.
+// There are two so a function can take an arena as parameter and still use
+// scratch memory itself, pass the parameter as `conflict` to get the other one.
+constexpr int SCRATCH_ARENA_COUNT = 2;
+constexpr size_t SCRATCH_ARENA_SIZE = MB(64);
+
+struct ScratchArenas
+{
+  BumpAllocator arenas[SCRATCH_ARENA_COUNT];
+
+  ~ScratchArenas()
+  {
+    for(int arenaIdx = 0; arenaIdx < SCRATCH_ARENA_COUNT; arenaIdx++)
+    {
+      bump_allocator_release(&arenas[arenaIdx]);
+    }
+  }
+};
+
+static thread_local ScratchArenas scratchArenas;
+
+// Use together with ScopedTempMemory, scratch memory is never reset otherwise
+BumpAllocator* get_scratch_arena(BumpAllocator* conflict = nullptr)
+{
+  for(int arenaIdx = 0; arenaIdx < SCRATCH_ARENA_COUNT; arenaIdx++)
+  {
+    BumpAllocator* arena = &scratchArenas.arenas[arenaIdx];
+    if(arena == conflict)
+    {
+      continue;
+    }
+
+    if(!arena->memory)
+    {
+      *arena = make_virtual_bump_allocator(SCRATCH_ARENA_SIZE, BUMP_ALLOCATOR_GUARD_PAGE);
+    }
+
+    return arena;
+  }
+
+  SM_ASSERT(false, "No free Scratch Arena");
+  return nullptr;
+}
+
 // #############################################################################
 //                           File I/O
 // #############################################################################
@@ -307,6 +918,110 @@ void write_file(const char* filePath, char* buffer, int size)
   fclose(file);
 }
 
+// Also succeeds if the directory already exists
+bool create_directory(const char* path)
+{
+  SM_ASSERT(path, "No path supplied!");
+
+#ifdef _WIN32
+  bool result = CreateDirectoryA(path, nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+  bool result = mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+  if(!result)
+  {
+    SM_ERROR("Failed creating Directory: %s", path);
+  }
+
+  return result;
+}
+
+// Read only view of a whole file, see map_file()
+struct MappedFile
+{
+  char* data;
+  long size;
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+#endif
+};
+
+// The pages are read on first access instead of copied up front,
+// data is null if the file can't be opened or is empty
+MappedFile map_file(const char* filePath)
+{
+  SM_ASSERT(filePath, "No filePath supplied!");
+
+  MappedFile mappedFile = {};
+#ifdef _WIN32
+  mappedFile.file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, 
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(mappedFile.file == INVALID_HANDLE_VALUE)
+  {
+    SM_ERROR("Failed opening File: %s", filePath);
+    return {};
+  }
+
+  LARGE_INTEGER fileSize = {};
+  GetFileSizeEx(mappedFile.file, &fileSize);
+  mappedFile.mapping = fileSize.QuadPart? 
+    CreateFileMappingA(mappedFile.file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+  mappedFile.data = mappedFile.mapping? (char*)MapViewOfFile(mappedFile.mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if(!mappedFile.data)
+  {
+    SM_ERROR("Failed mapping File: %s", filePath);
+    if(mappedFile.mapping)
+    {
+      CloseHandle(mappedFile.mapping);
+    }
+    CloseHandle(mappedFile.file);
+    return {};
+  }
+  mappedFile.size = (long)fileSize.QuadPart;
+#else
+  int fileDescriptor = open(filePath, O_RDONLY);
+  if(fileDescriptor < 0)
+  {
+    SM_ERROR("Failed opening File: %s", filePath);
+    return {};
+  }
+
+  // The mapping stays valid after closing the file
+  struct stat fileStat = {};
+  fstat(fileDescriptor, &fileStat);
+  void* data = fileStat.st_size? mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0) :
+                                 MAP_FAILED;
+  close(fileDescriptor);
+  if(data == MAP_FAILED)
+  {
+    SM_ERROR("Failed mapping File: %s", filePath);
+    return {};
+  }
+  mappedFile.data = (char*)data;
+  mappedFile.size = (long)fileStat.st_size;
+#endif
+
+  return mappedFile;
+}
+
+void unmap_file(MappedFile* mappedFile)
+{
+  if(!mappedFile->data)
+  {
+    return;
+  }
+
+#ifdef _WIN32
+  UnmapViewOfFile(mappedFile->data);
+  CloseHandle(mappedFile->mapping);
+  CloseHandle(mappedFile->file);
+#else
+  munmap(mappedFile->data, mappedFile->size);
+#endif
+  *mappedFile = {};
+}
+
 bool copy_file(const char* fileName, const char* outputName, char* buffer)
 {
   int fileSize = 0;
@@ -338,6 +1053,8 @@ bool copy_file(const char* fileName, const char* outputName, BumpAllocator* bump
 
   if(fileSize2)
   {
+    // The buffer is only needed for the copy
+    ScopedTempMemory tempMemory(bumpAllocator);
     char* buffer = bump_alloc(bumpAllocator, fileSize2 + 1);
 
     return copy_file(fileName, outputName, buffer);
@@ -475,6 +1192,11 @@ struct IVec2
     return {x / scalar, y / scalar};
   }
 
+  bool operator==(IVec2 other)
+  {
+    return x == other.x && y == other.y;
+  }
+
 };
 
 Vec2 vec_2(IVec2 v)
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "breaknotes_lib.h"
+#include "input.h"
+#include "platform.h"
+
+// Used to spin the last part of a wait
+#include <thread>
+
+// #############################################################################
+//                           Frame Pacer Constants
+// #############################################################################
+// Sleeping is only accurate to about a millisecond (or worse),
+// the last part of every wait is spent spinning instead
+constexpr double FRAME_PACER_SPIN_TIME = 0.002;
+
+// #############################################################################
+//                           Frame Pacer Structs
+// #############################################################################
+struct FramePacer
+{
+  double targetFrameTime; // 0 means uncapped, Vsync paces the frames
+  double deadline;        // When the current frame should end
+  double lastFrameEndTime;
+  bool started;
+
+  // Frame times of the last FRAME_STATS_SAMPLE_COUNT frames
+  float samples[FRAME_STATS_SAMPLE_COUNT];
+  int sampleIdx;
+  int sampleCount;
+
+  FrameStats stats;
+};
+
+// #############################################################################
+//                           Frame Pacer Functions
+// #############################################################################
+void set_target_fps(FramePacer* framePacer, int targetFps)
+{
+  framePacer->targetFrameTime = targetFps? 1.0 / targetFps : 0.0;
+  framePacer->stats.targetFrameTime = (float)framePacer->targetFrameTime;
+}
+
+// Called at the end of every frame, waits until the target frame time is reached
+void frame_pacer_end_frame(FramePacer* framePacer)
+{
+  double now = platform_get_time();
+  if(!framePacer->started)
+  {
+    framePacer->started = true;
+    framePacer->lastFrameEndTime = now;
+    framePacer->deadline = now + framePacer->targetFrameTime;
+    return;
+  }
+
+  double workTime = now - framePacer->lastFrameEndTime;
+
+  if(framePacer->targetFrameTime > 0.0)
+  {
+    // Hybrid wait, sleep while it's safe, then spin until the deadline
+    double sleepTime = framePacer->deadline - now - FRAME_PACER_SPIN_TIME;
+    if(sleepTime > 0.0)
+    {
+      platform_sleep((unsigned int)(sleepTime * 1000.0));
+    }
+
+    now = platform_get_time();
+    while(now < framePacer->deadline)
+    {
+      std::this_thread::yield();
+      now = platform_get_time();
+    }
+
+    // Missed by more than a frame, don't try to catch up with short frames
+    if(now - framePacer->deadline > framePacer->targetFrameTime)
+    {
+      framePacer->deadline = now;
+    }
+    framePacer->deadline += framePacer->targetFrameTime;
+  }
+
+  float frameTime = (float)(now - framePacer->lastFrameEndTime);
+  framePacer->lastFrameEndTime = now;
+
+  // Statistics
+  {
+    FrameStats* stats = &framePacer->stats;
+    stats->frameTime = frameTime;
+    stats->workTime = (float)workTime;
+    stats->frameCount++;
+    if(framePacer->targetFrameTime > 0.0 && workTime > framePacer->targetFrameTime)
+    {
+      stats->missedFrames++;
+    }
+
+    framePacer->samples[framePacer->sampleIdx] = frameTime;
+    framePacer->sampleIdx = (framePacer->sampleIdx + 1) % FRAME_STATS_SAMPLE_COUNT;
+    framePacer->sampleCount = min(framePacer->sampleCount + 1, FRAME_STATS_SAMPLE_COUNT);
+
+    float sum = 0.0f;
+    stats->minFrameTime = framePacer->samples[0];
+    stats->maxFrameTime = framePacer->samples[0];
+    for(int idx = 0; idx < framePacer->sampleCount; idx++)
+    {
+      sum += framePacer->samples[idx];
+      stats->minFrameTime = min(stats->minFrameTime, framePacer->samples[idx]);
+      stats->maxFrameTime = max(stats->maxFrameTime, framePacer->samples[idx]);
+    }
+    stats->avgFrameTime = sum / framePacer->sampleCount;
+    stats->fps = stats->avgFrameTime > 0.0f? 1.0f / stats->avgFrameTime : 0.0f;
+  }
+}
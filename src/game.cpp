@@ -27,6 +27,9 @@ void update_fps(float dt)
       gameState->frameCount = 0;
       gameState->fpsUpdateTimer = 0.0f;
   }
+
+  // The main thread logs it from the snapshot, the GameState belongs to the Simulation
+  renderData->currentFps = gameState->currentFps;
 }
 
 
@@ -59,27 +62,802 @@ bool is_down(GameInputType type)
   return false;
 }
 
-// Get a pointer to a tile at the specified grid coordinates
-Tile* get_tile(int x, int y)
+// Apply all Input Events that happened before the given time,
+// later ones stay in the queue for the next simulation step
+void consume_input_events(double time)
+{
+  InputEventQueue* queue = &input->events;
+  while(queue->count() && queue->peek()->time <= time)
+  {
+    InputEvent event = queue->pop();
+
+    switch(event.type)
+    {
+      case INPUT_EVENT_KEY:
+      {
+        // Sticky until the end of the step, a tap within one step is pressed and released
+        Key* key = &input->keys[event.keyCode];
+        key->justPressed |= !key->isDown && event.isDown;
+        key->justReleased |= key->isDown && !event.isDown;
+        key->isDown = event.isDown;
+        key->halfTransitionCount++;
+
+        break;
+      }
+
+      case INPUT_EVENT_MOUSE_MOVE:
+      {
+        input->mousePos = event.mousePos;
+        input->mousePosWorld = screen_to_world(event.mousePos);
+
+        break;
+      }
+    }
+  }
+}
+
+// #############################################################################
+//                           Tile World
+// #############################################################################
+// Rounds towards negative infinity, Tiles and Chunks can be negative
+int floor_div(int value, int divisor)
+{
+  int result = value / divisor;
+  return (value % divisor && (value < 0) != (divisor < 0))? result - 1 : result;
+}
+
+// Always in [0, divisor), also for negative values
+int floor_mod(int value, int divisor)
+{
+  return value - floor_div(value, divisor) * divisor;
+}
+
+// Convert world coordinates to grid coordinates by dividing by TILESIZE
+IVec2 get_tile_pos(IVec2 worldPos)
+{
+  return {floor_div(worldPos.x, TILESIZE), floor_div(worldPos.y, TILESIZE)};
+}
+
+IVec2 get_chunk_pos(int x, int y)
+{
+  return {floor_div(x, CHUNK_SIZE), floor_div(y, CHUNK_SIZE)};
+}
+
+unsigned int hash_chunk_pos(IVec2 chunkPos)
+{
+  return ((unsigned int)chunkPos.x * 73856093u) ^ ((unsigned int)chunkPos.y * 19349663u);
+}
+
+// Only finds resident Chunks, see get_chunk() to load them
+TileChunk* find_chunk(IVec2 chunkPos)
+{
+  TileWorld* tileWorld = &gameState->tileWorld;
+  int chunkIdx = tileWorld->hashSlots[hash_chunk_pos(chunkPos) & (CHUNK_HASH_SLOT_COUNT - 1)];
+  while(chunkIdx)
+  {
+    TileChunk* chunk = &tileWorld->chunks[chunkIdx - 1];
+    if(chunk->chunkPos == chunkPos)
+    {
+      return chunk;
+    }
+    chunkIdx = chunk->nextInSlot;
+  }
+
+  return nullptr;
+}
+
+// Tiles of Chunks that aren't resident count as hidden
+bool is_tile_visible(int x, int y)
+{
+  TileChunk* chunk = find_chunk(get_chunk_pos(x, y));
+  if(!chunk)
+  {
+    return false;
+  }
+
+  int localX = x - chunk->chunkPos.x * CHUNK_SIZE;
+  int localY = y - chunk->chunkPos.y * CHUNK_SIZE;
+  return (chunk->visibleRows[localY] >> localX) & 1;
+}
+
+// Writes a Tile into the Tile Map or the retained Render Layer, if it's
+// inside the window, only changed Tiles get uploaded
+void set_tile_rendering(int x, int y, bool isVisible, int neighbourMask)
+{
+  TileWorld* tileWorld = &gameState->tileWorld;
+  int windowX = x - tileWorld->windowOrigin.x;
+  int windowY = y - tileWorld->windowOrigin.y;
+  if(!tileWorld->hasWindow || 
+     windowX < 0 || windowX >= tileWorld->windowSize.x || 
+     windowY < 0 || windowY >= tileWorld->windowSize.y)
+  {
+    return;
+  }
+
+  if(TILEMAP_RENDERING)
+  {
+    tile_map_set(windowX, windowY, isVisible? neighbourMask : TILEMAP_EMPTY_TILE);
+    return;
+  }
+
+  // Like the Tile Map, a Tile keeps its instance while it stays in the window
+  int instanceIdx = floor_mod(y, tileWorld->windowSize.y) * tileWorld->windowSize.x + 
+                    floor_mod(x, tileWorld->windowSize.x);
+  if (!isVisible)
+  {
+    render_layer_hide(gameState->tileLayerID, instanceIdx);
+    return;
+  }
+
+  // Draw Tile
+  Transform transform = {};
+  // Draw the Tile around the center
+  transform.pos = {x * (float) TILESIZE, y * (float) TILESIZE};
+  transform.size = {TILESIZE, TILESIZE};
+  transform.spriteSize = {TILESIZE, TILESIZE};
+  // Select the appropriate tile sprite based on its neighbor mask
+  transform.atlasOffset = gameState->tileCoords[neighbourMask];
+  render_layer_set(gameState->tileLayerID, instanceIdx, transform);
+}
+
+void update_tile_rendering(TileChunk* chunk, int localX, int localY)
+{
+  set_tile_rendering(chunk->chunkPos.x * CHUNK_SIZE + localX, chunk->chunkPos.y * CHUNK_SIZE + localY,
+                     (chunk->visibleRows[localY] >> localX) & 1, chunk->neighbourMasks[localY][localX]);
+}
+
+void update_chunk_rendering(TileChunk* chunk)
+{
+  TileWorld* tileWorld = &gameState->tileWorld;
+  IVec2 windowChunkMin = get_chunk_pos(tileWorld->windowOrigin.x, tileWorld->windowOrigin.y);
+  IVec2 windowChunkMax = get_chunk_pos(tileWorld->windowOrigin.x + tileWorld->windowSize.x - 1,
+                                       tileWorld->windowOrigin.y + tileWorld->windowSize.y - 1);
+  if(!tileWorld->hasWindow || 
+     chunk->chunkPos.x < windowChunkMin.x || chunk->chunkPos.x > windowChunkMax.x ||
+     chunk->chunkPos.y < windowChunkMin.y || chunk->chunkPos.y > windowChunkMax.y)
+  {
+    return;
+  }
+
+  for (int localY = 0; localY < CHUNK_SIZE; localY++)
+  {
+    for (int localX = 0; localX < CHUNK_SIZE; localX++)
+    {
+      update_tile_rendering(chunk, localX, localY);
+    }
+  }
+}
+
+// Moves the rendered window by whole Chunks. Tiles keep their place in the
+// Tile Map / Render Layer while they stay in the window, so only the Chunks
+// that came into it are written
+void set_tile_window(IVec2 windowOrigin)
+{
+  TileWorld* tileWorld = &gameState->tileWorld;
+  IVec2 windowSize = tileWorld->windowSize;
+  IVec2 oldOrigin = tileWorld->windowOrigin;
+  bool rewriteAll = !tileWorld->hasWindow;
+
+  Vec2 windowPos = {(float)windowOrigin.x * TILESIZE, (float)windowOrigin.y * TILESIZE};
+  if(TILEMAP_RENDERING)
+  {
+    if(!tileWorld->hasWindow)
+    {
+      // Starts out empty
+      create_tile_map(windowSize, TILESIZE, windowPos,
+                      gameState->tileCoords.elements, gameState->tileCoords.count);
+    }
+    else
+    {
+      tile_map_scroll(windowOrigin.x - oldOrigin.x, windowOrigin.y - oldOrigin.y);
+    }
+  }
+  else
+  {
+    // Packed positions only reach this far from the layer origin, see encode_transform(),
+    // the layer is moved and written again once the window gets close to that
+    float reach = (float)(INT16_MAX >> TRANSFORM_FRACTION_BITS);
+    Vec2 windowEnd = {windowPos.x + windowSize.x * TILESIZE, windowPos.y + windowSize.y * TILESIZE};
+    Vec2 layerOrigin = renderData->renderLayers->layers[gameState->tileLayerID].origin;
+    if(!tileWorld->hasWindow ||
+       windowPos.x <= layerOrigin.x - reach || windowEnd.x >= layerOrigin.x + reach ||
+       windowPos.y <= layerOrigin.y - reach || windowEnd.y >= layerOrigin.y + reach)
+    {
+      render_layer_set_origin(gameState->tileLayerID, {(windowPos.x + windowEnd.x) / 2.0f, 
+                                                       (windowPos.y + windowEnd.y) / 2.0f});
+      rewriteAll = true;
+    }
+  }
+
+  tileWorld->windowOrigin = windowOrigin;
+  tileWorld->hasWindow = true;
+
+  IVec2 oldChunkMin = get_chunk_pos(oldOrigin.x, oldOrigin.y);
+  IVec2 oldChunkMax = get_chunk_pos(oldOrigin.x + windowSize.x - 1, oldOrigin.y + windowSize.y - 1);
+  IVec2 windowChunkMin = get_chunk_pos(windowOrigin.x, windowOrigin.y);
+  IVec2 windowChunkMax = get_chunk_pos(windowOrigin.x + windowSize.x - 1, windowOrigin.y + windowSize.y - 1);
+  for(int chunkY = windowChunkMin.y; chunkY <= windowChunkMax.y; chunkY++)
+  {
+    for(int chunkX = windowChunkMin.x; chunkX <= windowChunkMax.x; chunkX++)
+    {
+      if(!rewriteAll && 
+         chunkX >= oldChunkMin.x && chunkX <= oldChunkMax.x && 
+         chunkY >= oldChunkMin.y && chunkY <= oldChunkMax.y)
+      {
+        continue;
+      }
+
+      if(TileChunk* chunk = find_chunk({chunkX, chunkY}))
+      {
+        update_chunk_rendering(chunk);
+        continue;
+      }
+
+      // Not loaded yet, the Tiles that scrolled out are still there
+      for(int y = chunkY * CHUNK_SIZE; y < (chunkY + 1) * CHUNK_SIZE; y++)
+      {
+        for(int x = chunkX * CHUNK_SIZE; x < (chunkX + 1) * CHUNK_SIZE; x++)
+        {
+          set_tile_rendering(x, y, false, 0);
+        }
+      }
+    }
+  }
+}
+
+// #############################################################################
+//                           Autotiling
+// #############################################################################
+// The mask only depends on Tiles up to 2 away, see NEIGHBOUR_OFFSETS
+constexpr int AUTOTILE_RADIUS = 2;
+
+// Neighbouring Tiles                  Top    Left      Right       Bottom  
+constexpr IVec2 NEIGHBOUR_OFFSETS[12] = {{ 0,-1}, {-1, 0}, { 1, 0}, { 0, 1},
+//                                    Topleft Topright Bottomleft Bottomright
+                                         {-1,-1}, { 1,-1}, {-1, 1}, { 1, 1},
+//                                     Top2   Left2     Right2      Bottom2
+                                         { 0,-2}, {-2, 0}, { 2, 0}, { 0, 2}};
+
+// Topleft     = BIT(4) = 16
+// Toplright   = BIT(5) = 32
+// Bottomleft  = BIT(6) = 64
+// Bottomright = BIT(7) = 128
+
+// Maps the 12 neighbour bits (bit n set if NEIGHBOUR_OFFSETS[n] is visible)
+// to the index into tileCoords
+struct NeighbourMaskTable
+{
+  unsigned char masks[4096];
+};
+
+constexpr NeighbourMaskTable make_neighbour_mask_table()
+{
+  NeighbourMaskTable table = {};
+  for(int neighbourBits = 0; neighbourBits < 4096; neighbourBits++)
+  {
+    int neighbourCount = 0;
+    int extendedNeighbourCount = 0;
+    int emptyNeighbourSlot = 0;
+    for(int n = 0; n < 12; n++)
+    {
+      if(neighbourBits & BIT(n))
+      {
+        if(n < 8) // Counting direct neighbors
+        {
+          neighbourCount++;
+        }
+        else // Counting neighbors 1 Tile away
+        {
+          extendedNeighbourCount++;
+        }
+      }
+      else if(n < 8)
+      {
+        emptyNeighbourSlot = n;
+      }
+    }
+
+    // Determine the final neighbor mask based on surrounding tiles
+    if(neighbourCount == 7 && emptyNeighbourSlot >= 4) // We have a corner
+    {
+      table.masks[neighbourBits] = 16 + (emptyNeighbourSlot - 4);
+    }
+    else if(neighbourCount == 8 && extendedNeighbourCount == 4) // Black inside
+    {
+      table.masks[neighbourBits] = 20;
+    }
+    else
+    {
+      table.masks[neighbourBits] = neighbourBits & 0b1111;
+    }
+  }
+
+  return table;
+}
+
+constexpr NeighbourMaskTable NEIGHBOUR_MASK_TABLE = make_neighbour_mask_table();
+
+// Masks go up to 20, so 5 bits
+constexpr int NEIGHBOUR_MASK_BIT_COUNT = 5;
+
+// The same classification as NEIGHBOUR_MASK_TABLE, on 32 Tiles at once.
+// Bit x of every word is the Tile at x, outPlanes[b] gets bit b of their masks
+constexpr void classify_neighbour_rows(const uint32_t* neighbours, uint32_t* outPlanes)
+{
+  uint32_t top = neighbours[0];
+  uint32_t left = neighbours[1];
+  uint32_t right = neighbours[2];
+  uint32_t bottom = neighbours[3];
+  uint32_t orthogonal = top & left & right & bottom;
+  uint32_t diagonal = neighbours[4] & neighbours[5] & neighbours[6] & neighbours[7];
+  uint32_t extended = neighbours[8] & neighbours[9] & neighbours[10] & neighbours[11];
+
+  // A corner misses exactly one diagonal neighbour, its mask is 16 + (slot - 4)
+  uint32_t corners[4] = {};
+  for(int corner = 0; corner < 4; corner++)
+  {
+    uint32_t otherDiagonals = ~0u;
+    for(int other = 0; other < 4; other++)
+    {
+      otherDiagonals &= other == corner? ~0u : neighbours[4 + other];
+    }
+    corners[corner] = orthogonal & ~neighbours[4 + corner] & otherDiagonals;
+  }
+
+  // Black inside is 20
+  uint32_t inside = orthogonal & diagonal & extended;
+  uint32_t special = corners[0] | corners[1] | corners[2] | corners[3] | inside;
+
+  // Everything else is the 4 orthogonal bits
+  outPlanes[0] = (top & ~special) | corners[1] | corners[3];
+  outPlanes[1] = (left & ~special) | corners[2] | corners[3];
+  outPlanes[2] = (right & ~special) | inside;
+  outPlanes[3] = bottom & ~special;
+  outPlanes[4] = special;
+}
+
+constexpr bool neighbour_rows_match_table()
+{
+  for(int neighbourBits = 0; neighbourBits < 4096; neighbourBits++)
+  {
+    uint32_t neighbours[12] = {};
+    for(int n = 0; n < 12; n++)
+    {
+      neighbours[n] = (neighbourBits >> n) & 1;
+    }
+
+    uint32_t planes[NEIGHBOUR_MASK_BIT_COUNT] = {};
+    classify_neighbour_rows(neighbours, planes);
+
+    int neighbourMask = 0;
+    for(int bitIdx = 0; bitIdx < NEIGHBOUR_MASK_BIT_COUNT; bitIdx++)
+    {
+      neighbourMask |= (planes[bitIdx] & 1) << bitIdx;
+    }
+
+    if(neighbourMask != NEIGHBOUR_MASK_TABLE.masks[neighbourBits])
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static_assert(neighbour_rows_match_table(), "classify_neighbour_rows() differs from NEIGHBOUR_MASK_TABLE");
+
+// Moves bit i of the index to bit 0 of byte i, turns a bit plane into 8 bytes at once
+struct ByteSpreadTable
+{
+  uint64_t spreads[256];
+};
+
+constexpr ByteSpreadTable make_byte_spread_table()
+{
+  ByteSpreadTable table = {};
+  for(int bits = 0; bits < 256; bits++)
+  {
+    for(int bitIdx = 0; bitIdx < 8; bitIdx++)
+    {
+      table.spreads[bits] |= (uint64_t)((bits >> bitIdx) & 1) << (bitIdx * 8);
+    }
+  }
+
+  return table;
+}
+
+constexpr ByteSpreadTable BYTE_SPREAD_TABLE = make_byte_spread_table();
+
+// Only meaningful for visible Tiles
+int compute_neighbour_mask(int x, int y)
+{
+  int neighbourBits = 0;
+  for(int n = 0; n < 12; n++)
+  {
+    if(is_tile_visible(x + NEIGHBOUR_OFFSETS[n].x, y + NEIGHBOUR_OFFSETS[n].y))
+    {
+      neighbourBits |= BIT(n);
+    }
+  }
+
+  return NEIGHBOUR_MASK_TABLE.masks[neighbourBits];
+}
+
+// The rows of the Chunk, widened by AUTOTILE_RADIUS Tiles of its neighbours on
+// every side. Bit x + AUTOTILE_RADIUS of a row is the Tile at x, so every
+// neighbour direction is one shift
+void get_padded_chunk_rows(TileChunk* chunk, uint64_t* outRows)
+{
+  TileChunk* neighbours[3][3] = {};
+  for(int chunkY = 0; chunkY < 3; chunkY++)
+  {
+    for(int chunkX = 0; chunkX < 3; chunkX++)
+    {
+      neighbours[chunkY][chunkX] = find_chunk({chunk->chunkPos.x + chunkX - 1, 
+                                               chunk->chunkPos.y + chunkY - 1});
+    }
+  }
+
+  for(int paddedY = 0; paddedY < CHUNK_SIZE + 2 * AUTOTILE_RADIUS; paddedY++)
+  {
+    int y = paddedY - AUTOTILE_RADIUS;
+    int chunkY = y < 0? 0 : (y < CHUNK_SIZE? 1 : 2);
+    int localY = y - (chunkY - 1) * CHUNK_SIZE;
+
+    uint64_t row = 0;
+    if(TileChunk* left = neighbours[chunkY][0])
+    {
+      row |= left->visibleRows[localY] >> (CHUNK_SIZE - AUTOTILE_RADIUS);
+    }
+    if(TileChunk* center = neighbours[chunkY][1])
+    {
+      row |= (uint64_t)center->visibleRows[localY] << AUTOTILE_RADIUS;
+    }
+    if(TileChunk* right = neighbours[chunkY][2])
+    {
+      row |= (uint64_t)right->visibleRows[localY] << (CHUNK_SIZE + AUTOTILE_RADIUS);
+    }
+    outRows[paddedY] = row;
+  }
+}
+
+// Computes the masks of all Tiles in the Chunk into outMasks, a row at a time:
+// every neighbour direction is one shift of the padded rows, the whole row is
+// classified with bit operations, then 8 masks are written at once.
+// Hidden Tiles get a mask as well, it's never read
+void compute_chunk_neighbour_masks(TileChunk* chunk, unsigned char (*outMasks)[CHUNK_SIZE])
+{
+  uint64_t paddedRows[CHUNK_SIZE + 2 * AUTOTILE_RADIUS];
+  get_padded_chunk_rows(chunk, paddedRows);
+
+  for(int localY = 0; localY < CHUNK_SIZE; localY++)
+  {
+    if(!chunk->visibleRows[localY])
+    {
+      continue;
+    }
+
+    uint32_t neighbours[12];
+    for(int n = 0; n < 12; n++)
+    {
+      neighbours[n] = (uint32_t)(paddedRows[localY + AUTOTILE_RADIUS + NEIGHBOUR_OFFSETS[n].y] >> 
+                                 (AUTOTILE_RADIUS + NEIGHBOUR_OFFSETS[n].x));
+    }
+
+    uint32_t planes[NEIGHBOUR_MASK_BIT_COUNT];
+    classify_neighbour_rows(neighbours, planes);
+
+    // Little endian, byte i of the word is the mask of Tile i
+    for(int firstX = 0; firstX < CHUNK_SIZE; firstX += 8)
+    {
+      uint64_t masks = 0;
+      for(int bitIdx = 0; bitIdx < NEIGHBOUR_MASK_BIT_COUNT; bitIdx++)
+      {
+        masks |= BYTE_SPREAD_TABLE.spreads[(planes[bitIdx] >> firstX) & 0xFF] << bitIdx;
+      }
+      memcpy(&outMasks[localY][firstX], &masks, sizeof(masks));
+    }
+  }
+}
+
+// Recomputes the masks of every Tile in the Chunk, needed when it or a neighbour is loaded
+void autotile_chunk(TileChunk* chunk)
+{
+  compute_chunk_neighbour_masks(chunk, chunk->neighbourMasks);
+  update_chunk_rendering(chunk);
+}
+
+// Only the Tiles within AUTOTILE_RADIUS of an edit can change
+void autotile_around(IVec2 tilePos)
+{
+  for(int y = tilePos.y - AUTOTILE_RADIUS; y <= tilePos.y + AUTOTILE_RADIUS; y++)
+  {
+    for(int x = tilePos.x - AUTOTILE_RADIUS; x <= tilePos.x + AUTOTILE_RADIUS; x++)
+    {
+      TileChunk* chunk = find_chunk(get_chunk_pos(x, y));
+      if(!chunk)
+      {
+        continue;
+      }
+
+      int localX = x - chunk->chunkPos.x * CHUNK_SIZE;
+      int localY = y - chunk->chunkPos.y * CHUNK_SIZE;
+      if(is_tile_visible(x, y))
+      {
+        chunk->neighbourMasks[localY][localX] = compute_neighbour_mask(x, y);
+      }
+      update_tile_rendering(chunk, localX, localY);
+    }
+  }
+}
+
+#ifdef AUTOTILE_SELF_CHECK
+// Compares the incremental masks against a full rebuild, the masks at the
+// border of a Chunk depend on its neighbours, so only Chunks with all
+// neighbours resident are exact
+void verify_autotiling()
+{
+  TileWorld* tileWorld = &gameState->tileWorld;
+  for(int chunkIdx = 0; chunkIdx < MAX_RESIDENT_CHUNKS; chunkIdx++)
+  {
+    TileChunk* chunk = &tileWorld->chunks[chunkIdx];
+    if(!chunk->isResident)
+    {
+      continue;
+    }
+
+    bool neighboursResident = true;
+    for(int n = 0; n < 8; n++)
+    {
+      IVec2 neighbourPos = {chunk->chunkPos.x + NEIGHBOUR_OFFSETS[n].x, 
+                            chunk->chunkPos.y + NEIGHBOUR_OFFSETS[n].y};
+      neighboursResident = neighboursResident && find_chunk(neighbourPos);
+    }
+    if(!neighboursResident)
+    {
+      continue;
+    }
+
+    unsigned char expectedMasks[CHUNK_SIZE][CHUNK_SIZE];
+    compute_chunk_neighbour_masks(chunk, expectedMasks);
+    for(int localY = 0; localY < CHUNK_SIZE; localY++)
+    {
+      for(int localX = 0; localX < CHUNK_SIZE; localX++)
+      {
+        if((chunk->visibleRows[localY] >> localX) & 1)
+        {
+          int neighbourMask = chunk->neighbourMasks[localY][localX];
+          SM_ASSERT(neighbourMask == expectedMasks[localY][localX], 
+                    "Autotiling mismatch at %d, %d: %d != %d",
+                    chunk->chunkPos.x * CHUNK_SIZE + localX, chunk->chunkPos.y * CHUNK_SIZE + localY, 
+                    neighbourMask, expectedMasks[localY][localX]);
+        }
+      }
+    }
+  }
+}
+#endif
+
+// #############################################################################
+//                           Chunk Streaming
+// #############################################################################
+void get_chunk_path(IVec2 chunkPos, char* path, int pathSize)
+{
+  snprintf(path, pathSize, "%s/chunk_%d_%d.bin", gameState->tileWorld.saveDirectory, chunkPos.x, chunkPos.y);
+}
+
+// Only the visibility is stored, the masks are recomputed on load.
+// The world is sparse, empty Chunks have no file
+void save_chunk(TileChunk* chunk)
+{
+  chunk->isDirty = false;
+  if(!gameState->tileWorld.saveDirectory[0])
+  {
+    return;
+  }
+
+  char path[320];
+  get_chunk_path(chunk->chunkPos, path, sizeof(path));
+
+  bool isEmpty = true;
+  for(int localY = 0; localY < CHUNK_SIZE; localY++)
+  {
+    isEmpty = isEmpty && !chunk->visibleRows[localY];
+  }
+
+  if(isEmpty)
+  {
+    remove(path);
+  }
+  else
+  {
+    write_file(path, (char*)chunk->visibleRows, sizeof(chunk->visibleRows));
+  }
+
+  gameState->tileWorld.saveCount++;
+}
+
+void load_chunk(TileChunk* chunk)
+{
+  memset(chunk->visibleRows, 0, sizeof(chunk->visibleRows));
+  if(!gameState->tileWorld.saveDirectory[0])
+  {
+    return;
+  }
+
+  char path[320];
+  get_chunk_path(chunk->chunkPos, path, sizeof(path));
+  if(!file_exists(path))
+  {
+    return;
+  }
+
+  if(get_file_size(path) != sizeof(chunk->visibleRows))
+  {
+    SM_WARN("Ignoring Chunk with the wrong size: %s", path);
+    return;
+  }
+
+  // read_file() writes a terminating 0
+  char buffer[sizeof(chunk->visibleRows) + 1];
+  int fileSize = 0;
+  if(read_file(path, &fileSize, buffer))
+  {
+    memcpy(chunk->visibleRows, buffer, sizeof(chunk->visibleRows));
+    gameState->tileWorld.loadCount++;
+  }
+}
+
+void unlink_chunk(TileChunk* chunk)
+{
+  TileWorld* tileWorld = &gameState->tileWorld;
+  int chunkIdx = (int)(chunk - tileWorld->chunks) + 1;
+  int* link = &tileWorld->hashSlots[hash_chunk_pos(chunk->chunkPos) & (CHUNK_HASH_SLOT_COUNT - 1)];
+  while(*link != chunkIdx)
+  {
+    SM_ASSERT(*link, "Chunk not in its hash slot: %d, %d", chunk->chunkPos.x, chunk->chunkPos.y);
+    link = &tileWorld->chunks[*link - 1].nextInSlot;
+  }
+  *link = chunk->nextInSlot;
+}
+
+// Finds or loads the Chunk, if all Chunks are resident the least
+// recently used one is saved (if it changed) and evicted
+TileChunk* get_chunk(IVec2 chunkPos)
+{
+  TileWorld* tileWorld = &gameState->tileWorld;
+  TileChunk* chunk = find_chunk(chunkPos);
+  if(chunk)
+  {
+    chunk->lastUsedFrame = tileWorld->frame;
+    return chunk;
+  }
+
+  TileChunk* leastRecentlyUsed = nullptr;
+  for(int chunkIdx = 0; chunkIdx < MAX_RESIDENT_CHUNKS; chunkIdx++)
+  {
+    TileChunk* candidate = &tileWorld->chunks[chunkIdx];
+    if(!candidate->isResident)
+    {
+      chunk = candidate;
+      break;
+    }
+
+    if(!leastRecentlyUsed || candidate->lastUsedFrame < leastRecentlyUsed->lastUsedFrame)
+    {
+      leastRecentlyUsed = candidate;
+    }
+  }
+
+  if(!chunk)
+  {
+    chunk = leastRecentlyUsed;
+    SM_ASSERT(chunk->lastUsedFrame < tileWorld->frame, "All resident Chunks are in use");
+    if(chunk->isDirty)
+    {
+      save_chunk(chunk);
+    }
+    unlink_chunk(chunk);
+    tileWorld->evictionCount++;
+  }
+
+  int slotIdx = hash_chunk_pos(chunkPos) & (CHUNK_HASH_SLOT_COUNT - 1);
+  chunk->chunkPos = chunkPos;
+  chunk->isResident = true;
+  chunk->isDirty = false;
+  chunk->lastUsedFrame = tileWorld->frame;
+  chunk->nextInSlot = tileWorld->hashSlots[slotIdx];
+  tileWorld->hashSlots[slotIdx] = (int)(chunk - tileWorld->chunks) + 1;
+  load_chunk(chunk);
+
+  // The masks of this Chunk and at the border of its neighbours depend on the new Tiles
+  for(int chunkY = chunkPos.y - 1; chunkY <= chunkPos.y + 1; chunkY++)
+  {
+    for(int chunkX = chunkPos.x - 1; chunkX <= chunkPos.x + 1; chunkX++)
+    {
+      if(TileChunk* neighbour = find_chunk({chunkX, chunkY}))
+      {
+        autotile_chunk(neighbour);
+      }
+    }
+  }
+
+  return chunk;
+}
+
+// Runs in the tick, so it never loads, false if the Chunk isn't resident.
+// The caller updates the masks, see autotile_around()
+bool set_tile_visible(int x, int y, bool visible)
 {
-  Tile* tile = nullptr;
-    // Check if the coordinates are within the world grid boundaries
-  if(x >= 0 && x < WORLD_GRID.x && y >= 0 && y < WORLD_GRID.y)
+  TileChunk* chunk = find_chunk(get_chunk_pos(x, y));
+  if(!chunk)
   {
-    tile = &gameState->worldGrid[x][y];
+    return false;
   }
 
-  return tile;
+  int localX = x - chunk->chunkPos.x * CHUNK_SIZE;
+  int localY = y - chunk->chunkPos.y * CHUNK_SIZE;
+
+  uint32_t bit = 1u << localX;
+  uint32_t* row = &chunk->visibleRows[localY];
+  *row = visible? (*row | bit) : (*row & ~bit);
+  chunk->isDirty = true;
+  chunk->lastEditFrame = gameState->tileWorld.frame;
+  return true;
 }
 
-// Get a pointer to a tile at the specified world position
-Tile* get_tile(IVec2 worldPos) // convert world position to tile position
+// Keeps the Chunks around the view resident, moves the rendered window
+// with the camera and saves edited Chunks in the background.
+// All Chunk file I/O happens here, once per frame outside of the fixed steps
+void update_chunk_residency()
 {
-  // Convert world coordinates to grid coordinates by dividing by TILESIZE
-  int x = worldPos.x / TILESIZE;
-  int y = worldPos.y / TILESIZE;
+  TileWorld* tileWorld = &gameState->tileWorld;
+  OrthographicCamera2D camera = renderData->gameCamera;
+
+  // The camera y is negated
+  int chunkPixels = CHUNK_SIZE * TILESIZE;
+  Vec2 viewCenter = {camera.position.x, -camera.position.y};
+  IVec2 viewMin = {(int)floorf(viewCenter.x - camera.dimensions.x / 2.0f), 
+                   (int)floorf(viewCenter.y - camera.dimensions.y / 2.0f)};
+  IVec2 viewMax = {(int)ceilf(viewCenter.x + camera.dimensions.x / 2.0f) - 1, 
+                   (int)ceilf(viewCenter.y + camera.dimensions.y / 2.0f) - 1};
+  IVec2 firstChunk = {floor_div(viewMin.x, chunkPixels), floor_div(viewMin.y, chunkPixels)};
+  IVec2 lastChunk = {floor_div(viewMax.x, chunkPixels), floor_div(viewMax.y, chunkPixels)};
 
-  return get_tile(x, y);
+  for(int chunkY = firstChunk.y - CHUNK_RESIDENCY_MARGIN; chunkY <= lastChunk.y + CHUNK_RESIDENCY_MARGIN; chunkY++)
+  {
+    for(int chunkX = firstChunk.x - CHUNK_RESIDENCY_MARGIN; chunkX <= lastChunk.x + CHUNK_RESIDENCY_MARGIN; chunkX++)
+    {
+      get_chunk({chunkX, chunkY});
+    }
+  }
+
+  // One save per frame at most, the Chunk wasn't edited for a while
+  for(int chunkIdx = 0; chunkIdx < MAX_RESIDENT_CHUNKS; chunkIdx++)
+  {
+    TileChunk* chunk = &tileWorld->chunks[chunkIdx];
+    if(chunk->isResident && chunk->isDirty && tileWorld->frame - chunk->lastEditFrame >= CHUNK_SAVE_DELAY)
+    {
+      save_chunk(chunk);
+      break;
+    }
+  }
+
+  IVec2 windowOrigin = {firstChunk.x * CHUNK_SIZE, firstChunk.y * CHUNK_SIZE};
+  if(!tileWorld->hasWindow || !(windowOrigin == tileWorld->windowOrigin))
+  {
+    set_tile_window(windowOrigin);
+  }
+}
+
+// The window covers the view, wherever it sits relative to the Chunk grid
+IVec2 get_tile_window_size(Vec2 viewDimensions)
+{
+  int chunkPixels = CHUNK_SIZE * TILESIZE;
+  IVec2 windowChunks = {((int)ceilf(viewDimensions.x) + chunkPixels - 1) / chunkPixels + 1,
+                        ((int)ceilf(viewDimensions.y) + chunkPixels - 1) / chunkPixels + 1};
+
+  return {windowChunks.x * CHUNK_SIZE, windowChunks.y * CHUNK_SIZE};
 }
 
 // Main simulation function, called at a fixed time step
@@ -109,18 +887,46 @@ void simulate()
     }
   }
 
-  bool updateTiles = false;
+  // Scroll the camera when the Player leaves the view, the camera y is negated
+  {
+    OrthographicCamera2D* camera = &renderData->gameCamera;
+    Vec2 halfDimensions = camera->dimensions / 2.0f;
+    Vec2 viewCenter = {camera->position.x, -camera->position.y};
+    IVec2 playerPos = gameState->player.pos;
+
+    if(playerPos.x < viewCenter.x - halfDimensions.x)
+    {
+      camera->position.x = playerPos.x + halfDimensions.x;
+    }
+    if(playerPos.x > viewCenter.x + halfDimensions.x)
+    {
+      camera->position.x = playerPos.x - halfDimensions.x;
+    }
+    if(playerPos.y < viewCenter.y - halfDimensions.y)
+    {
+      camera->position.y = -(playerPos.y + halfDimensions.y);
+    }
+    if(playerPos.y > viewCenter.y + halfDimensions.y)
+    {
+      camera->position.y = -(playerPos.y - halfDimensions.y);
+    }
+  }
+
+  // Tiles changed this tick, both buttons can paint at the same time
+  Array<IVec2, 2> editedTiles;
+
   // Handle left mouse button (make tiles visible)
   if(is_down(MOUSE_LEFT))
   {
     IVec2 worldPos = screen_to_world(input->mousePos);
     IVec2 mousePosWorld = input->mousePosWorld;
-    Tile* tile = get_tile(worldPos);
+    IVec2 tilePos = get_tile_pos(worldPos);
 
-    if(tile)
+    // Only changes need an update, holding the button over painted tiles is common.
+    // The Chunks around the view are resident, see update_chunk_residency()
+    if(!is_tile_visible(tilePos.x, tilePos.y) && set_tile_visible(tilePos.x, tilePos.y, true))
     {
-      tile->isVisible = true;
-      updateTiles = true;
+      editedTiles.add(tilePos);
     }
   }
 
@@ -129,84 +935,25 @@ void simulate()
   {
     IVec2 worldPos = screen_to_world(input->mousePos);
     IVec2 mousePosWorld = input->mousePosWorld;
-    Tile* tile = get_tile(worldPos);
-    if(tile)
+    IVec2 tilePos = get_tile_pos(worldPos);
+    if(is_tile_visible(tilePos.x, tilePos.y) && set_tile_visible(tilePos.x, tilePos.y, false))
     {
-      tile->isVisible = false;
-      updateTiles = true;
+      editedTiles.add(tilePos);
     }
   }
 
-  if(updateTiles)
-    // Update tile neighbor masks if any tiles changed visibility
+  // Update tile neighbor masks around the changed tiles
+  for(int editIdx = 0; editIdx < editedTiles.count; editIdx++)
   {
-    // Neighbouring Tiles        Top    Left      Right       Bottom  
-    int neighbourOffsets[24] = { 0,-1,  -1, 0,     1, 0,       0, 1,   
-    //                          Topleft Topright Bottomleft Bottomright
-                                -1,-1,   1,-1,    -1, 1,       1, 1,
-    //                           Top2   Left2     Right2      Bottom2
-                                 0,-2,  -2, 0,     2, 0,       0, 2};
-
-    // Topleft     = BIT(4) = 16
-    // Toplright   = BIT(5) = 32
-    // Bottomleft  = BIT(6) = 64
-    // Bottomright = BIT(7) = 128
-
-    for(int y = 0; y < WORLD_GRID.y; y++)
-    {
-      for(int x = 0; x < WORLD_GRID.x; x++)
-      {
-        Tile* tile = get_tile(x, y);
-        if(!tile->isVisible) // if tile is not visible, continue
-        {
-          continue;
-        }
-
-        tile->neighbourMask = 0;
-        int neighbourCount = 0;
-        int extendedNeighbourCount = 0;
-        int emptyNeighbourSlot = 0;
-
-        // Look at the surrounding  12 surrounding 
-        for(int n = 0; n < 12; n++)
-        {
-          Tile* neighbour = get_tile(x + neighbourOffsets[n * 2], y + neighbourOffsets[n * 2 + 1]);
-
-          // No neighbour means the edge of the world
-          if(!neighbour || neighbour->isVisible)
-          {
-            tile->neighbourMask |= BIT(n);
-            if(n < 8) // Counting direct neighbors
-            {
-              neighbourCount++;
-            }
-            else // Counting neighbors 1 Tile away
-            {
-              extendedNeighbourCount++;
-            }
-          }
-          else if(n < 8)
-          {
-            emptyNeighbourSlot = n;
-          }
-        }
+    autotile_around(editedTiles[editIdx]);
+  }
 
-        // Determine the final neighbor mask based on surrounding tiles
-        if(neighbourCount == 7 && emptyNeighbourSlot >= 4) // We have a corner
-        {
-          tile->neighbourMask = 16 + (emptyNeighbourSlot - 4);
-        }
-        else if(neighbourCount == 8 && extendedNeighbourCount == 4)
-        {
-          tile->neighbourMask = 20;
-        }
-        else
-        {
-          tile->neighbourMask = tile->neighbourMask & 0b1111;
-        }
-      }
-    }
+#ifdef AUTOTILE_SELF_CHECK
+  if(editedTiles.count)
+  {
+    verify_autotiling();
   }
+#endif
 }
 
 // #############################################################################
@@ -253,6 +1000,29 @@ EXPORT_FN void update_game(GameState* gameStateIn, RenderData* renderDataIn, Inp
     gameState->tileCoords.add({tilesPosition.x, tilesPosition.y + 5 * TILESIZE});
     }
 
+    // Tile World, Chunks are streamed in around the camera, see update_chunk_residency()
+    {
+      TileWorld* tileWorld = &gameState->tileWorld;
+      char* saveDirectory = getenv("BREAKOUT_SAVE_DIRECTORY");
+      if(!saveDirectory)
+      {
+        saveDirectory = input->chunkSavingOff? (char*)"" : (char*)CHUNK_SAVE_DIRECTORY;
+      }
+      snprintf(tileWorld->saveDirectory, sizeof(tileWorld->saveDirectory), "%s", saveDirectory);
+      if(tileWorld->saveDirectory[0])
+      {
+        create_directory(tileWorld->saveDirectory);
+      }
+      tileWorld->windowSize = get_tile_window_size(renderData->gameCamera.dimensions);
+      if(!TILEMAP_RENDERING)
+      {
+        gameState->tileLayerID = create_render_layer(tileWorld->windowSize.x * tileWorld->windowSize.y);
+      }
+
+      // The first steps can already paint
+      update_chunk_residency();
+    }
+
     // Key Mappings
     {
       gameState->keyMappings[MOVE_UP].keys.add(KEY_W);
@@ -272,11 +1042,29 @@ EXPORT_FN void update_game(GameState* gameStateIn, RenderData* renderDataIn, Inp
 
   // Fixed Update Loop
   {
+    gameState->tileWorld.frame++;
     gameState->updateTimer += dt;
     update_fps(dt);
+
+    // The time the simulation has reached, each step advances it by UPDATE_DELAY
+    double simulationTime = input->time - gameState->updateTimer;
+    int substeps = 0;
     while(gameState->updateTimer >= UPDATE_DELAY)
     {
+      if(substeps++ == MAX_SUBSTEPS)
+      {
+        // Out of budget, keep the fraction for interpolation, drop the whole steps
+        float droppedTime = floorf(gameState->updateTimer / UPDATE_DELAY) * UPDATE_DELAY;
+        gameState->updateTimer -= droppedTime;
+        gameState->dilatedTime += droppedTime;
+        break;
+      }
+
       gameState->updateTimer -= UPDATE_DELAY;
+      simulationTime += UPDATE_DELAY;
+
+      // Every step sees exactly the Input that happened before it
+      consume_input_events(simulationTime);
       simulate(); // draw tiles and update player
 
       // Relative Mouse here, because more frames than simulation
@@ -295,6 +1083,8 @@ EXPORT_FN void update_game(GameState* gameStateIn, RenderData* renderDataIn, Inp
     }
   }
 
+  update_chunk_residency();
+
   // Calculate interpolation factor for smooth rendering between fixed updates
   float interpolatedDT = (float)(gameState->updateTimer / UPDATE_DELAY);
 
@@ -309,28 +1099,5 @@ EXPORT_FN void update_game(GameState* gameStateIn, RenderData* renderDataIn, Inp
 
   
 
-  // Drawing Tileset
-  {
-    for (int y = 0; y < WORLD_GRID.y; y++)
-    {
-      for (int x = 0; x < WORLD_GRID.x; x++)
-      {
-        Tile* tile = get_tile(x, y);
-        if (!tile->isVisible)
-        {
-          continue;
-        }
-
-        // Draw Tile
-        Transform transform = {};
-        // Draw the Tile around the center
-        transform.pos = {x * (float) TILESIZE, y * (float) TILESIZE};
-        transform.size = {TILESIZE, TILESIZE};
-        transform.spriteSize = {TILESIZE, TILESIZE};
-        // Select the appropriate tile sprite based on its neighbor mask
-        transform.atlasOffset = gameState->tileCoords[tile->neighbourMask];
-        draw_quad(transform);
-      }
-    }
-  } 
+  // The Tileset is drawn by the renderer, see update_tile_rendering()
 }
\ No newline at end of file
@@ -14,10 +14,26 @@
 constexpr int UPDATES_PER_SECOND = 120;
 // How long should the game wait before updating again
 constexpr double UPDATE_DELAY = 1.0 / UPDATES_PER_SECOND;
+// Simulation steps per frame, after that the remaining time is dropped and
+// the game slows down (time dilation) instead of spiraling into catch up steps
+constexpr int MAX_SUBSTEPS = 8;
 constexpr int WORLD_WIDTH = 320;
 constexpr int WORLD_HEIGHT = 180;
 constexpr int TILESIZE = 8;
-constexpr IVec2 WORLD_GRID = {WORLD_WIDTH / TILESIZE, WORLD_HEIGHT / TILESIZE}; // create grid of tiles 320/8 = 40, 180/8 = 22
+// Draws the Tiles as one quad through the Tile Map shader,
+// otherwise every Tile is an instance in a Render Layer
+constexpr bool TILEMAP_RENDERING = true;
+
+// The world is unbounded and split into Chunks, only the ones around the
+// camera are kept in memory, the rest lives on disk
+constexpr int CHUNK_SIZE = 32;                // Tiles per side, one uint32_t per row
+constexpr int MAX_RESIDENT_CHUNKS = 64;
+constexpr int CHUNK_HASH_SLOT_COUNT = 128;    // Power of 2
+constexpr int CHUNK_RESIDENCY_MARGIN = 1;     // Chunks around the view that stay loaded
+constexpr int CHUNK_SAVE_DELAY = 120;         // Frames after the last edit, before a Chunk is saved
+// Overwritten by the BREAKOUT_SAVE_DIRECTORY environment variable, empty turns saving off.
+// Not used if the Platform turned saving off, see Input::chunkSavingOff
+constexpr const char* CHUNK_SAVE_DIRECTORY = "saves";
 
 // #############################################################################
 //                           Game Structs
@@ -41,10 +57,34 @@ struct KeyMapping
   Array<KeyCodeID, 3> keys;
 };
 
-struct Tile
+struct TileChunk
+{
+  IVec2 chunkPos;           // In Chunks
+  bool isResident;
+  bool isDirty;             // Changed since the last save
+  int nextInSlot;           // chunkIdx + 1 of the next Chunk in the hash slot, 0 ends it
+  long long lastUsedFrame;  // For LRU eviction
+  long long lastEditFrame;
+  uint32_t visibleRows[CHUNK_SIZE];                      // Bit x is the Tile at x
+  unsigned char neighbourMasks[CHUNK_SIZE][CHUNK_SIZE];  // [y][x], only valid if visible
+};
+
+struct TileWorld
 {
-  int neighbourMask;
-  bool isVisible;
+  long long frame;
+  int hashSlots[CHUNK_HASH_SLOT_COUNT]; // chunkIdx + 1, 0 means empty
+  TileChunk chunks[MAX_RESIDENT_CHUNKS];
+
+  // The Tiles mirrored into the Tile Map / Render Layer, chunk aligned
+  IVec2 windowOrigin;  // In Tiles
+  IVec2 windowSize;    // In Tiles
+  bool hasWindow;
+
+  char saveDirectory[256]; // Empty if Chunks are not saved, evicted edits are lost then
+
+  int loadCount;
+  int saveCount;
+  int evictionCount;
 };
 
 struct Player
@@ -60,13 +100,15 @@ struct GameState
   Player player;
 
   Array<IVec2, 21> tileCoords;
-  Tile worldGrid[WORLD_GRID.x][WORLD_GRID.y];
+  TileWorld tileWorld;
+  int tileLayerID; // Retained Render Layer, one instance per Tile, if !TILEMAP_RENDERING
   
   KeyMapping keyMappings[GAME_INPUT_COUNT];
 
   float fpsUpdateTimer;
   int frameCount;
   float currentFps;
+  float dilatedTime; // Time dropped because of MAX_SUBSTEPS
 };
 
 
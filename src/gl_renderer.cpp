@@ -5,152 +5,1282 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "../third_party/stb_image.h"
 
+// To Load TTF Files
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+// Hot Reloading reads and decodes the files on other threads
+#include <thread>
+
 // #############################################################################
 //                           OpenGL Constants
 // #############################################################################
 const char* TEXTURE_PATH = "assets/textures/TEXTURE_ATLAS.png";
 
+// The CPU can be this many frames ahead of the GPU before it has to wait
+constexpr int STREAM_BUFFER_FRAME_COUNT = 3;
+
+// Binding points of the Storage Buffers, see quad.vert and quad.frag
+constexpr GLuint TRANSFORM_SBO_BINDING = 0;
+constexpr GLuint MATERIAL_SBO_BINDING = 1;
+
+// Linked programs are stored here, see gl_create_program()
+const char* PROGRAM_CACHE_DIRECTORY = "shader_cache";
+constexpr uint32_t PROGRAM_BINARY_MAGIC = 0x42505242; // "BRPB"
+
+// Rasterized fonts are stored here, see load_font()
+const char* FONT_CACHE_DIRECTORY = "font_cache";
+constexpr uint32_t FONT_CACHE_MAGIC = 0x42464E54; // "BFNT"
+constexpr int FONT_ATLAS_SIZE = 512;
+
+// Hot Reloading waits until the sizes of the files stop changing,
+// editors can still be writing when the change is reported
+constexpr int HOT_RELOAD_SETTLE_MS = 20;
+constexpr int HOT_RELOAD_MAX_SETTLE_ATTEMPTS = 25;
+constexpr size_t SHADER_RELOAD_STORAGE_SIZE = MB(1);
+
+// Texture Hot Reloading compares the images in blocks, changed blocks are uploaded
+constexpr int TEXTURE_DIFF_BLOCK_SIZE = 64;
+constexpr int MAX_TEXTURE_DIRTY_RECTS = 64; // More and the whole image is uploaded
+
+// Prepended to quad.vert and quad.frag, indexed by the SHADER_VARIANT_* bits
+const char* SHADER_VARIANT_DEFINES[SHADER_VARIANT_COUNT] =
+{
+  "",
+  "#define VARIANT_FONT\n",
+  "#define VARIANT_FLIP\n",
+  "#define VARIANT_FONT\n#define VARIANT_FLIP\n",
+};
+
+// #############################################################################
+//                           OpenGL Structs
+// #############################################################################
+// A persistently mapped buffer split into one region per frame in flight.
+// Every frame writes into the next region, a fence tells us when the GPU
+// is done reading it, so we never write memory the GPU still uses.
+struct StreamBuffer
+{
+  GLuint bufferID;
+  char* memory;     // Mapped for the whole lifetime, coherent
+  int regionSize;
+  int alignment;    // Of offsets passed to glBindBufferRange
+  int regionIdx;
+  int used;         // Bytes written into the current region
+  GLsync fences[STREAM_BUFFER_FRAME_COUNT];
+  int stallCount;   // Frames that had to wait for the GPU
+};
+
+// Start of a file in the Program Cache, the driver specific binary follows
+struct ProgramBinaryHeader
+{
+  uint32_t magic;
+  uint32_t binaryFormat;
+  uint64_t sourceHash; // Also the file name, see hash_program_sources()
+};
+
+// The files a program is built from, read once for hashing and compiling
+struct ProgramSources
+{
+  char* vertShaderPath;
+  char* fragShaderPath;
+  char* shaderHeader;
+  char* vertSource;
+  char* fragSource;
+};
+
+// A program that might still be compiling, see gl_begin_program()
+struct PendingProgram
+{
+  GLuint programID;
+  GLuint vertShaderID; // 0 if the program was loaded from the Program Cache
+  GLuint fragShaderID;
+  uint64_t sourceHash;
+};
+
+enum ShaderReloadState
+{
+  SHADER_RELOAD_IDLE,
+  SHADER_RELOAD_READING,   // The reader thread loads the sources
+  SHADER_RELOAD_COMPILING, // The driver compiles, the old programs are still used
+
+  SHADER_RELOAD_STATE_COUNT
+};
+
+// Hot Reloading of quad.vert and quad.frag, advanced once per frame by
+// gl_update_shader_reload(). Only the file reads happen on another thread
+struct ShaderReload
+{
+  ShaderReloadState state;
+  bool requested;                 // Changed while a reload was running, starts again after it
+  std::thread readerThread;       // Joined before the next reload and by gl_shutdown()
+  std::atomic<bool> sourcesReady; // Set by the reader thread once it's done
+  bool sourcesValid;
+  BumpAllocator sourceStorage;    // Holds the sources, reset for every reload
+  ProgramSources sources;
+  PendingProgram pendingPrograms[SHADER_VARIANT_COUNT];
+};
+
+enum TextureReloadState
+{
+  TEXTURE_RELOAD_IDLE,
+  TEXTURE_RELOAD_DECODING, // The decoder thread loads the PNG and compares it
+
+  TEXTURE_RELOAD_STATE_COUNT
+};
+
+// Hot Reloading of the Texture Atlas, advanced once per frame by gl_update_texture_reload().
+// The decoder thread owns the pixels while decoding, the render thread afterwards
+struct TextureReload
+{
+  TextureReloadState state;
+  bool requested;                // Changed while a reload was running, starts again after it
+  std::thread decoderThread;     // Joined before the next reload and by gl_shutdown()
+  std::atomic<bool> decodeDone;  // Set by the decoder thread once it's done
+
+  unsigned char* pixels;         // The image on the GPU, RGBA, kept to diff against
+  IVec2 size;
+  unsigned char* newPixels;      // Null if decoding failed
+  IVec2 newSize;
+  Array<IRect, MAX_TEXTURE_DIRTY_RECTS> dirtyRects;
+  bool fullUpload;               // Size changed or too many dirty rects
+
+  GLuint pixelBufferID;          // GL_PIXEL_UNPACK_BUFFER, orphaned for every upload
+};
+
+// Start of a file in the Font Cache, the R8 atlas follows
+struct FontCacheHeader
+{
+  uint32_t magic;
+  int fontSize;
+  uint64_t fontHash;   // Of the font file
+  int atlasSize;       // Width and height
+  int fontHeight;
+  Glyph glyphs[127];   // Same as RenderData::glyphs
+};
+
+// quad.vert and quad.frag compiled with the #defines of one Shader Variant
+struct QuadProgram
+{
+  GLuint programID;
+  GLint orthoProjectionID;
+  GLint instanceOriginID;
+};
+
+// What gl_render() needs of a Render Layer, copied with its instances
+// because the game moves and fills the layers while we render
+struct RenderLayerDraw
+{
+  Vec2 origin;
+  int shaderVariant;
+  int count;
+};
+
+struct GLContext
+{
+  QuadProgram quadPrograms[SHADER_VARIANT_COUNT]; // Indexed by the Shader Variant
+  GLuint textureID;            // Immutable storage, recreated if the size changes
+  TextureReload textureReload;
+  StreamBuffer instanceBuffer; // Transforms and UI Transforms
+  GLuint materialSBOID;
+  int uploadedMaterialCount;   // Materials only change by being added
+  GLuint renderLayerSBOIDs[MAX_RENDER_LAYERS];
+  RenderLayerDraw renderLayerDraws[MAX_RENDER_LAYERS];
+  int renderLayerCount;
+  GLuint quadIndexBufferID;    // Two triangles over the 4 corners, shared by every quad
+
+  // Tile Map
+  GLuint tileMapProgramID;
+  GLuint tileMapTextureID; // One texel per tile, GL_R8UI
+  IVec2 tileMapTextureSize; // Also the size the Tile Map had when it was copied
+  Vec2 tileMapPos;         // Copied with the tiles, the game scrolls the map while we render
+  IVec2 tileMapOffset;
+  int tileMapTileSize;
+  GLuint tileMapOrthoProjectionID;
+  GLuint tileMapPosID;
+  GLuint tileMapOffsetID;
+  GLuint tileMapSizeID;
+  GLuint tileSizeID;
+  GLuint tileAtlasCoordsID;
+  GLuint fontAtlasID;
+
+  // Program Cache, off if the driver has no binary formats
+  int programBinaryFormatCount;
+  int cachedProgramCount; // Programs loaded from the cache instead of compiled
+
+  bool parallelShaderCompile; // KHR / ARB_parallel_shader_compile, compiles don't block
+  ShaderReload shaderReload;
+
+  int textureWatchID;
+  int vertShaderWatchID;
+  int fragShaderWatchID;
+};
+
+// #############################################################################
+//                           OpenGL Globals
+// #############################################################################
+static GLContext glContext;
+
+// #############################################################################
+//                           OpenGL Functions
+// #############################################################################
+StreamBuffer gl_create_stream_buffer(int regionSize)
+{
+  StreamBuffer streamBuffer = {};
+
+  GLint alignment = 0;
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  streamBuffer.alignment = alignment > 0? alignment : 256;
+  streamBuffer.regionSize = (regionSize + streamBuffer.alignment - 1) / 
+                            streamBuffer.alignment * streamBuffer.alignment;
+
+  // Coherent, so writes are visible to the GPU without flushing
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  GLsizeiptr bufferSize = (GLsizeiptr)streamBuffer.regionSize * STREAM_BUFFER_FRAME_COUNT;
+
+  glGenBuffers(1, &streamBuffer.bufferID);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, streamBuffer.bufferID);
+  glBufferStorage(GL_SHADER_STORAGE_BUFFER, bufferSize, nullptr, flags);
+  streamBuffer.memory = (char*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bufferSize, flags);
+  SM_ASSERT(streamBuffer.memory, "Failed to map Stream Buffer");
+
+  return streamBuffer;
+}
+
+// End of the run of instances in the chunk that share the variant of the one at start
+int get_variant_run_end(InstanceChunk* chunk, int start)
+{
+  int shaderVariant = get_shader_variant(chunk->instances[start]);
+  int end = start + 1;
+  while(end < chunk->count && get_shader_variant(chunk->instances[end]) == shaderVariant)
+  {
+    end++;
+  }
+
+  return end;
+}
+
+// Bytes the batches of the frame take up in a region, every batch starts aligned
+int stream_buffer_get_size(StreamBuffer* streamBuffer, RenderData* frameData)
+{
+  int alignment = streamBuffer->alignment;
+  int size = 0;
+  for(int batchIdx = 0; batchIdx < frameData->sortedBatchCount; batchIdx++)
+  {
+    int batchSize = sizeof(InstanceData) * frameData->sortedBatches[batchIdx].count;
+    size += (batchSize + alignment - 1) / alignment * alignment;
+  }
+
+  // Unsorted, see gl_draw_unsorted_instances()
+  if(!frameData->sortedInstances)
+  {
+    InstanceList* lists[RENDER_PASS_COUNT] = {&frameData->transforms, &frameData->uiTransforms};
+    for(int pass = 0; pass < RENDER_PASS_COUNT; pass++)
+    {
+      for(InstanceChunk* chunk = lists[pass]->first; chunk; chunk = chunk->next)
+      {
+        for(int start = 0; start < chunk->count;)
+        {
+          int end = get_variant_run_end(chunk, start);
+          int batchSize = sizeof(InstanceData) * (end - start);
+          size += (batchSize + alignment - 1) / alignment * alignment;
+          start = end;
+        }
+      }
+    }
+  }
+
+  return size;
+}
+
+// Recreates the buffer with bigger regions if the frame doesn't fit,
+// GL keeps the old buffer alive until the draws using it are done
+void stream_buffer_reserve(StreamBuffer* streamBuffer, int frameSize)
+{
+  if(frameSize <= streamBuffer->regionSize)
+  {
+    return;
+  }
+
+  for(int regionIdx = 0; regionIdx < STREAM_BUFFER_FRAME_COUNT; regionIdx++)
+  {
+    if(streamBuffer->fences[regionIdx])
+    {
+      glDeleteSync(streamBuffer->fences[regionIdx]);
+    }
+  }
+  glDeleteBuffers(1, &streamBuffer->bufferID);
+
+  int stallCount = streamBuffer->stallCount;
+  int regionSize = frameSize > streamBuffer->regionSize * 2? frameSize : streamBuffer->regionSize * 2;
+  *streamBuffer = gl_create_stream_buffer(regionSize);
+  streamBuffer->stallCount = stallCount;
+  SM_TRACE("Stream Buffer grew to %d KB per Frame", streamBuffer->regionSize / 1024);
+}
+
+// Moves on to the next region, waits if the GPU still reads from it
+void stream_buffer_begin_frame(StreamBuffer* streamBuffer)
+{
+  streamBuffer->regionIdx = (streamBuffer->regionIdx + 1) % STREAM_BUFFER_FRAME_COUNT;
+  streamBuffer->used = 0;
+
+  GLsync fence = streamBuffer->fences[streamBuffer->regionIdx];
+  if(fence)
+  {
+    GLenum waitResult = glClientWaitSync(fence, 0, 0);
+    if(waitResult == GL_TIMEOUT_EXPIRED)
+    {
+      streamBuffer->stallCount++;
+      do
+      {
+        waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      } while(waitResult == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(fence);
+    streamBuffer->fences[streamBuffer->regionIdx] = 0;
+  }
+}
+
+// Copies the data into the current region and binds that range,
+// returns false if there was nothing to bind
+bool stream_buffer_push(StreamBuffer* streamBuffer, GLuint binding, void* data, int size)
+{
+  if(!size)
+  {
+    return false;
+  }
+
+  int offset = (streamBuffer->used + streamBuffer->alignment - 1) / 
+               streamBuffer->alignment * streamBuffer->alignment;
+  if(offset + size > streamBuffer->regionSize)
+  {
+    SM_ASSERT(false, "Stream Buffer is full");
+    return false;
+  }
+
+  int bufferOffset = streamBuffer->regionIdx * streamBuffer->regionSize + offset;
+  memcpy(streamBuffer->memory + bufferOffset, data, size);
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, streamBuffer->bufferID, bufferOffset, size);
+  streamBuffer->used = offset + size;
+
+  return true;
+}
+
+// The region can be reused once the GPU is past this point
+void stream_buffer_end_frame(StreamBuffer* streamBuffer)
+{
+  streamBuffer->fences[streamBuffer->regionIdx] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// 4 vertices per quad through the shared index buffer, instead of 6
+void gl_draw_quads(int instanceCount)
+{
+  glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, nullptr, instanceCount);
+}
+
+// Binds the program of the variant and sets its uniforms
+void gl_use_quad_program(int shaderVariant, Mat4* orthoProjection, Vec2 instanceOrigin)
+{
+  QuadProgram* program = &glContext.quadPrograms[shaderVariant];
+  glUseProgram(program->programID);
+  glUniformMatrix4fv(program->orthoProjectionID, 1, GL_FALSE, &orthoProjection->ax);
+  glUniform2fv(program->instanceOriginID, 1, &instanceOrigin.x);
+}
+
+// Fallback if sort_instances() ran out of Frame Arena, draws the list in call order
+// with one batch per run of the same variant inside a chunk. Nothing is blended,
+// translucent instances come out opaque until the arena has room again
+void gl_draw_unsorted_instances(StreamBuffer* streamBuffer, RenderPass pass,
+                                Mat4* orthoProjection, Vec2 instanceOrigin)
+{
+  InstanceList* list = pass == RENDER_PASS_GAME? &renderData->transforms : &renderData->uiTransforms;
+  for(InstanceChunk* chunk = list->first; chunk; chunk = chunk->next)
+  {
+    for(int start = 0; start < chunk->count;)
+    {
+      int end = get_variant_run_end(chunk, start);
+      if(stream_buffer_push(streamBuffer, TRANSFORM_SBO_BINDING, &chunk->instances[start],
+                            sizeof(InstanceData) * (end - start)))
+      {
+        gl_use_quad_program(get_shader_variant(chunk->instances[start]), orthoProjection, instanceOrigin);
+        gl_draw_quads(end - start);
+      }
+      start = end;
+    }
+  }
+}
+
+// Every batch is one draw call with the program of its variant. Translucent
+// batches are blended without writing depth, so they have to come after
+// everything opaque of the pass
+void gl_draw_instances(StreamBuffer* streamBuffer, RenderPass pass, OpacityClass opacityClass,
+                       Mat4* orthoProjection, Vec2 instanceOrigin)
+{
+  if(!renderData->sortedInstances)
+  {
+    if(opacityClass == OPACITY_OPAQUE)
+    {
+      gl_draw_unsorted_instances(streamBuffer, pass, orthoProjection, instanceOrigin);
+    }
+    return;
+  }
+
+  BatchRange range = renderData->sortedRanges[pass][opacityClass];
+  if(!range.count)
+  {
+    return;
+  }
+
+  if(opacityClass == OPACITY_TRANSLUCENT)
+  {
+    glEnable(GL_BLEND);
+    glDepthMask(GL_FALSE);
+  }
+
+  for(int batchIdx = range.start; batchIdx < range.start + range.count; batchIdx++)
+  {
+    InstanceBatch batch = renderData->sortedBatches[batchIdx];
+    if(stream_buffer_push(streamBuffer, TRANSFORM_SBO_BINDING, &renderData->sortedInstances[batch.start],
+                          sizeof(InstanceData) * batch.count))
+    {
+      gl_use_quad_program(batch.shaderVariant, orthoProjection, instanceOrigin);
+      gl_draw_quads(batch.count);
+    }
+  }
+
+  if(opacityClass == OPACITY_TRANSLUCENT)
+  {
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+  }
+}
+
+static void APIENTRY gl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                         GLsizei length, const GLchar* message, const void* user)
+{
+    const char* sourceStr;
+    switch(source)
+    {
+        case GL_DEBUG_SOURCE_API: sourceStr = "API"; break;
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: sourceStr = "Window System"; break;
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceStr = "Shader Compiler"; break;
+        case GL_DEBUG_SOURCE_THIRD_PARTY: sourceStr = "Third Party"; break;
+        case GL_DEBUG_SOURCE_APPLICATION: sourceStr = "Application"; break;
+        case GL_DEBUG_SOURCE_OTHER: sourceStr = "Other"; break;
+        default: sourceStr = "Unknown"; break;
+    }
+
+    const char* typeStr;
+    switch(type)
+    {
+        case GL_DEBUG_TYPE_ERROR: typeStr = "Error"; break;
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: typeStr = "Deprecated Behavior"; break;
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: typeStr = "Undefined Behavior"; break;
+        case GL_DEBUG_TYPE_PORTABILITY: typeStr = "Portability"; break;
+        case GL_DEBUG_TYPE_PERFORMANCE: typeStr = "Performance"; break;
+        case GL_DEBUG_TYPE_MARKER: typeStr = "Marker"; break;
+        case GL_DEBUG_TYPE_PUSH_GROUP: typeStr = "Push Group"; break;
+        case GL_DEBUG_TYPE_POP_GROUP: typeStr = "Pop Group"; break;
+        case GL_DEBUG_TYPE_OTHER: typeStr = "Other"; break;
+        default: typeStr = "Unknown"; break;
+    }
+
+    const char* severityStr;
+    switch(severity)
+    {
+        case GL_DEBUG_SEVERITY_HIGH: severityStr = "High"; break;
+        case GL_DEBUG_SEVERITY_MEDIUM: severityStr = "Medium"; break;
+        case GL_DEBUG_SEVERITY_LOW: severityStr = "Low"; break;
+        case GL_DEBUG_SEVERITY_NOTIFICATION: severityStr = "Notification"; break;
+        default: severityStr = "Unknown"; break;
+    }
+
+    printf("OpenGL Debug - Source: %s, Type: %s, ID: %u, Severity: %s\n", sourceStr, typeStr, id, severityStr);
+    printf("Message: %s\n", message);
+
+    if(severity == GL_DEBUG_SEVERITY_HIGH)
+    {
+        SM_ASSERT(false, "Critical OpenGL error");
+    }
+}
+
+// The defines go between the version and the shader header, so both can use them.
+// Doesn't wait for the compile, see gl_check_shader()
+GLuint gl_create_shader(int shaderType, const char* defines, char* shaderHeader, char* shaderSource)
+{
+  const char* shaderSources[] =
+  {
+    "#version 430 core\n",
+    defines,
+    shaderHeader,
+    shaderSource
+  };
+
+
+  GLuint shaderID = glCreateShader(shaderType);
+  glShaderSource(shaderID, ArraySize(shaderSources), shaderSources, 0);
+  glCompileShader(shaderID);
+
+  return shaderID;
+}
+
+bool gl_check_shader(GLuint shaderID, char* shaderPath)
+{
+  GLint compileStatus;
+  glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compileStatus);
+  if (compileStatus != GL_TRUE)
+  {
+      GLint logLength;
+      glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &logLength);
+      char* log = (char*)malloc(logLength);
+      glGetShaderInfoLog(shaderID, logLength, NULL, log);
+      
+      printf("Shader compilation failed for %s:\n%s\n", shaderPath, log);
+      
+      free(log);
+      return false;
+  }
+
+  return true;
+}
+
+// Only touches the files and the allocator, so it also runs on the reader thread
+bool read_program_sources(ProgramSources* sources, char* vertShaderPath, char* fragShaderPath,
+                          BumpAllocator* allocator)
+{
+  *sources = {};
+  sources->vertShaderPath = vertShaderPath;
+  sources->fragShaderPath = fragShaderPath;
+
+  int fileSize = 0;
+  sources->shaderHeader = read_file("src/shader_header.h", &fileSize, allocator);
+  sources->vertSource = read_file(vertShaderPath, &fileSize, allocator);
+  sources->fragSource = read_file(fragShaderPath, &fileSize, allocator);
+
+  if(!sources->shaderHeader)
+  {
+    SM_ERROR("Failed to load shader_header.h");
+    return false;
+  }
+
+  if(!sources->vertSource || !sources->fragSource)
+  {
+    SM_ERROR("Failed to load shader: %s. Error: %s", 
+             sources->vertSource? fragShaderPath : vertShaderPath, strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+// The sources and the driver decide if a binary can be reused
+uint64_t hash_program_sources(const char* defines, char* shaderHeader, char* vertSource, char* fragSource)
+{
+  const char* glVersion = (const char*)glGetString(GL_VERSION);
+  const char* glRenderer = (const char*)glGetString(GL_RENDERER);
+
+  uint64_t hash = hash_bytes(defines, strlen(defines));
+  hash = hash_bytes(shaderHeader, strlen(shaderHeader), hash);
+  hash = hash_bytes(vertSource, strlen(vertSource), hash);
+  hash = hash_bytes(fragSource, strlen(fragSource), hash);
+  hash = hash_bytes(glVersion, glVersion? strlen(glVersion) : 0, hash);
+  hash = hash_bytes(glRenderer, glRenderer? strlen(glRenderer) : 0, hash);
+
+  return hash;
+}
+
+void get_program_binary_path(uint64_t sourceHash, char* path, int pathSize)
+{
+  snprintf(path, pathSize, "%s/%016llx.bin", PROGRAM_CACHE_DIRECTORY, (unsigned long long)sourceHash);
+}
+
+// Returns 0 on a miss, or if the driver rejects the binary
+GLuint gl_load_program_binary(uint64_t sourceHash, BumpAllocator* transientStorage)
+{
+  if(!glContext.programBinaryFormatCount)
+  {
+    return 0;
+  }
+
+  char path[256];
+  get_program_binary_path(sourceHash, path, sizeof(path));
+  if(!file_exists(path))
+  {
+    return 0;
+  }
+
+  int fileSize = 0;
+  char* file = read_file(path, &fileSize, transientStorage);
+  ProgramBinaryHeader* header = (ProgramBinaryHeader*)file;
+  if(!file || fileSize <= (int)sizeof(ProgramBinaryHeader) ||
+     header->magic != PROGRAM_BINARY_MAGIC || header->sourceHash != sourceHash)
+  {
+    SM_WARN("Invalid Program Binary: %s", path);
+    remove(path);
+    return 0;
+  }
+
+  GLuint programID = glCreateProgram();
+  glProgramBinary(programID, header->binaryFormat, file + sizeof(ProgramBinaryHeader), 
+                  fileSize - sizeof(ProgramBinaryHeader));
+
+  // Drivers reject binaries after updates, then it's compiled and cached again
+  int programSuccess;
+  glGetProgramiv(programID, GL_LINK_STATUS, &programSuccess);
+  if(!programSuccess)
+  {
+    SM_TRACE("Program Binary rejected by the driver: %s", path);
+    glDeleteProgram(programID);
+    remove(path);
+    return 0;
+  }
+
+  return programID;
+}
+
+void gl_save_program_binary(GLuint programID, uint64_t sourceHash, BumpAllocator* transientStorage)
+{
+  if(!glContext.programBinaryFormatCount)
+  {
+    return;
+  }
+
+  GLint binarySize = 0;
+  glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+  if(binarySize <= 0)
+  {
+    return;
+  }
+
+  char* file = bump_alloc(transientStorage, sizeof(ProgramBinaryHeader) + binarySize);
+  if(!file)
+  {
+    return;
+  }
+
+  ProgramBinaryHeader* header = (ProgramBinaryHeader*)file;
+  header->magic = PROGRAM_BINARY_MAGIC;
+  header->sourceHash = sourceHash;
+
+  GLsizei length = 0;
+  GLenum binaryFormat = 0;
+  glGetProgramBinary(programID, binarySize, &length, &binaryFormat, file + sizeof(ProgramBinaryHeader));
+  header->binaryFormat = binaryFormat;
+  if(length <= 0)
+  {
+    return;
+  }
+
+  char path[256];
+  get_program_binary_path(sourceHash, path, sizeof(path));
+  write_file(path, file, sizeof(ProgramBinaryHeader) + length);
+}
+
+// Loads the program from the Program Cache, or starts compiling and linking it.
+// The driver might compile in the background, see gl_program_ready()
+PendingProgram gl_begin_program(ProgramSources* sources, const char* defines, BumpAllocator* transientStorage)
+{
+  PendingProgram pending = {};
+  pending.sourceHash = hash_program_sources(defines, sources->shaderHeader, 
+                                            sources->vertSource, sources->fragSource);
+  pending.programID = gl_load_program_binary(pending.sourceHash, transientStorage);
+  if(pending.programID)
+  {
+    glContext.cachedProgramCount++;
+    return pending;
+  }
+
+  pending.vertShaderID = gl_create_shader(GL_VERTEX_SHADER, defines, sources->shaderHeader, sources->vertSource);
+  pending.fragShaderID = gl_create_shader(GL_FRAGMENT_SHADER, defines, sources->shaderHeader, sources->fragSource);
+
+  // Only starts the link, gl_finish_program() checks it and detaches the shaders
+  pending.programID = glCreateProgram();
+  glProgramParameteri(pending.programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glAttachShader(pending.programID, pending.vertShaderID);
+  glAttachShader(pending.programID, pending.fragShaderID);
+  glLinkProgram(pending.programID);
+
+  return pending;
+}
+
+// Without parallel shader compile there is no way to ask, gl_finish_program() blocks instead
+bool gl_program_ready(PendingProgram* pending)
+{
+  if(!glContext.parallelShaderCompile || !pending->vertShaderID)
+  {
+    return true;
+  }
+
+  GLint completed = GL_FALSE;
+  glGetProgramiv(pending->programID, GL_COMPLETION_STATUS_KHR, &completed);
+
+  return completed == GL_TRUE;
+}
+
+// Returns 0 if a Shader failed to compile or the Program failed to link,
+// successful programs are written to the Program Cache
+GLuint gl_finish_program(PendingProgram* pending, ProgramSources* sources, BumpAllocator* transientStorage)
+{
+  // Loaded from the Program Cache, already validated
+  if(!pending->vertShaderID)
+  {
+    return pending->programID;
+  }
+
+  // Check both, so both logs get printed
+  bool vertCompiled = gl_check_shader(pending->vertShaderID, sources->vertShaderPath);
+  bool fragCompiled = gl_check_shader(pending->fragShaderID, sources->fragShaderPath);
+
+  // Detaching and deleting the shaders to free up resources.
+  glDetachShader(pending->programID, pending->vertShaderID);
+  glDetachShader(pending->programID, pending->fragShaderID);
+  glDeleteShader(pending->vertShaderID);
+  glDeleteShader(pending->fragShaderID);
+  if(!vertCompiled || !fragCompiled)
+  {
+    glDeleteProgram(pending->programID);
+    return 0;
+  }
+
+  // Validate if program works
+  {
+    int programSuccess;
+    char programInfoLog[512];
+    glGetProgramiv(pending->programID, GL_LINK_STATUS, &programSuccess);
+
+    if(!programSuccess)
+    {
+      glGetProgramInfoLog(pending->programID, 512, 0, programInfoLog);
+      SM_ERROR("Failed to link program: %s", programInfoLog);
+      glDeleteProgram(pending->programID);
+      return 0;
+    }
+  }
+
+  gl_save_program_binary(pending->programID, pending->sourceHash, transientStorage);
+
+  return pending->programID;
+}
+
+// Returns 0 if a Shader fails to compile or the Program fails to link.
+// Programs built from the same sources before are loaded from the Program Cache
+GLuint gl_create_program(char* vertShaderPath, char* fragShaderPath, const char* defines,
+                         BumpAllocator* transientStorage)
+{
+  // OpenGL copies the sources, so the files can be freed when we are done
+  ScopedTempMemory tempMemory(transientStorage);
+
+  ProgramSources sources;
+  if(!read_program_sources(&sources, vertShaderPath, fragShaderPath, transientStorage))
+  {
+    return 0;
+  }
+
+  PendingProgram pending = gl_begin_program(&sources, defines, transientStorage);
+  return gl_finish_program(&pending, &sources, transientStorage);
+}
+
+QuadProgram make_quad_program(GLuint programID)
+{
+  QuadProgram program = {};
+  program.programID = programID;
+  program.orthoProjectionID = glGetUniformLocation(programID, "orthoProjection");
+  program.instanceOriginID = glGetUniformLocation(programID, "instanceOrigin");
+
+  return program;
+}
+
+// One program per Shader Variant, either all of them are created or none
+bool gl_create_quad_programs(QuadProgram* programs, BumpAllocator* transientStorage)
+{
+  for(int shaderVariant = 0; shaderVariant < SHADER_VARIANT_COUNT; shaderVariant++)
+  {
+    GLuint programID = gl_create_program("assets/shaders/quad.vert", "assets/shaders/quad.frag", 
+                                         SHADER_VARIANT_DEFINES[shaderVariant], transientStorage);
+    if(!programID)
+    {
+      for(int idx = 0; idx < shaderVariant; idx++)
+      {
+        glDeleteProgram(programs[idx].programID);
+      }
+      return false;
+    }
+
+    programs[shaderVariant] = make_quad_program(programID);
+  }
+
+  return true;
+}
+
+// Replaces sleeping on the render thread, editors can still be writing the files
+// when the change is reported. Only called on the Hot Reloading threads
+void wait_for_files_to_settle(char** filePaths, int fileCount)
+{
+  long fileSizes[4] = {-1, -1, -1, -1};
+  SM_ASSERT(fileCount <= ArraySize(fileSizes), "Too many Files: %d", fileCount);
+
+  for(int attempt = 0; attempt < HOT_RELOAD_MAX_SETTLE_ATTEMPTS; attempt++)
+  {
+    platform_sleep(HOT_RELOAD_SETTLE_MS);
+
+    bool settled = true;
+    for(int fileIdx = 0; fileIdx < fileCount; fileIdx++)
+    {
+      long fileSize = file_exists(filePaths[fileIdx])? get_file_size(filePaths[fileIdx]) : 0;
+      settled = settled && fileSize && fileSize == fileSizes[fileIdx];
+      fileSizes[fileIdx] = fileSize;
+    }
+
+    if(settled)
+    {
+      break;
+    }
+  }
+}
+
+// Runs on the reader thread, started by gl_update_shader_reload()
+void read_shader_reload_sources(ShaderReload* reload)
+{
+  char* vertShaderPath = "assets/shaders/quad.vert";
+  char* fragShaderPath = "assets/shaders/quad.frag";
+
+  char* filePaths[] = {vertShaderPath, fragShaderPath};
+  wait_for_files_to_settle(filePaths, ArraySize(filePaths));
+
+  reload->sourcesValid = read_program_sources(&reload->sources, vertShaderPath, fragShaderPath, 
+                                              &reload->sourceStorage);
+  reload->sourcesReady.store(true, std::memory_order_release);
+}
+
+// Called once per frame, never waits for the files and with parallel shader compile
+// not for the driver either. The old programs are used until every variant is ready,
+// a failed reload keeps them
+void gl_update_shader_reload(BumpAllocator* transientStorage)
+{
+  ShaderReload* reload = &glContext.shaderReload;
+
+  // Check both, so one change doesn't stay pending for the next frame
+  bool vertChanged = file_changed(glContext.vertShaderWatchID);
+  bool fragChanged = file_changed(glContext.fragShaderWatchID);
+  if(vertChanged || fragChanged)
+  {
+    reload->requested = true;
+  }
+
+  switch(reload->state)
+  {
+    case SHADER_RELOAD_IDLE:
+    {
+      if(reload->requested)
+      {
+        reload->requested = false;
+        reload->sourcesReady.store(false, std::memory_order_relaxed);
+        bump_allocator_reset(&reload->sourceStorage);
+        if(reload->readerThread.joinable())
+        {
+          reload->readerThread.join();
+        }
+        reload->readerThread = std::thread(read_shader_reload_sources, reload);
+        reload->state = SHADER_RELOAD_READING;
+      }
+
+      break;
+    }
+
+    case SHADER_RELOAD_READING:
+    {
+      if(!reload->sourcesReady.load(std::memory_order_acquire))
+      {
+        break;
+      }
+
+      if(!reload->sourcesValid)
+      {
+        SM_ERROR("Failed to reload Shaders, keeping the old ones");
+        reload->state = SHADER_RELOAD_IDLE;
+        break;
+      }
+
+      for(int shaderVariant = 0; shaderVariant < SHADER_VARIANT_COUNT; shaderVariant++)
+      {
+        reload->pendingPrograms[shaderVariant] = gl_begin_program(&reload->sources, 
+                                                                  SHADER_VARIANT_DEFINES[shaderVariant], 
+                                                                  transientStorage);
+      }
+      reload->state = SHADER_RELOAD_COMPILING;
+
+      break;
+    }
+
+    case SHADER_RELOAD_COMPILING:
+    {
+      for(int shaderVariant = 0; shaderVariant < SHADER_VARIANT_COUNT; shaderVariant++)
+      {
+        if(!gl_program_ready(&reload->pendingPrograms[shaderVariant]))
+        {
+          return;
+        }
+      }
+
+      QuadProgram quadPrograms[SHADER_VARIANT_COUNT] = {};
+      bool success = true;
+      for(int shaderVariant = 0; shaderVariant < SHADER_VARIANT_COUNT; shaderVariant++)
+      {
+        GLuint programID = gl_finish_program(&reload->pendingPrograms[shaderVariant], 
+                                             &reload->sources, transientStorage);
+        quadPrograms[shaderVariant] = make_quad_program(programID);
+        success = success && programID;
+      }
+
+      for(int shaderVariant = 0; shaderVariant < SHADER_VARIANT_COUNT; shaderVariant++)
+      {
+        if(success)
+        {
+          glDeleteProgram(glContext.quadPrograms[shaderVariant].programID);
+          glContext.quadPrograms[shaderVariant] = quadPrograms[shaderVariant];
+        }
+        else if(quadPrograms[shaderVariant].programID)
+        {
+          glDeleteProgram(quadPrograms[shaderVariant].programID);
+        }
+      }
+
+      if(success)
+      {
+        SM_TRACE("Reloaded Shaders");
+      }
+      else
+      {
+        SM_ERROR("Failed to reload Shaders, keeping the old ones");
+      }
+      reload->state = SHADER_RELOAD_IDLE;
+
+      break;
+    }
+  }
+}
 
-// #############################################################################
-//                           OpenGL Structs
-// #############################################################################
-struct GLContext
+// Immutable storage, a different size needs a new texture
+GLuint gl_create_atlas_texture(IVec2 size)
 {
-  GLuint programID;
   GLuint textureID;
-  GLuint transformSBOID;
-  GLuint materialSBOID;
-  GLuint screenSizeID;
-  GLuint orthoProjectionID;
-  GLuint fontAtlasID;
-
-  long long textureTimestamp;
-  long long shaderTimestamp;
-};
-
-// #############################################################################
-//                           OpenGL Globals
-// #############################################################################
-static GLContext glContext;
+  glGenTextures(1, &textureID);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+
+  // set the texture wrapping/filtering options (on the currently bound texture object)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  // This setting only matters when using the GLSL texture() function
+  // When you use texelFetch() this setting has no effect,
+  // because texelFetch is designed for this purpose
+  // See: https://interactiveimmersive.io/blog/glsl/glsl-data-tricks/
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_SRGB8_ALPHA8, size.x, size.y);
+
+  return textureID;
+}
 
-// #############################################################################
-//                           OpenGL Functions
-// #############################################################################
-static void APIENTRY gl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
-                                         GLsizei length, const GLchar* message, const void* user)
+bool texture_block_changed(TextureReload* reload, int blockX, int blockY, int blockHeight)
 {
-    const char* sourceStr;
-    switch(source)
+  int blockWidth = min(TEXTURE_DIFF_BLOCK_SIZE, reload->size.x - blockX);
+  for(int y = blockY; y < blockY + blockHeight; y++)
+  {
+    int offset = (y * reload->size.x + blockX) * 4;
+    if(memcmp(reload->pixels + offset, reload->newPixels + offset, blockWidth * 4) != 0)
     {
-        case GL_DEBUG_SOURCE_API: sourceStr = "API"; break;
-        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: sourceStr = "Window System"; break;
-        case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceStr = "Shader Compiler"; break;
-        case GL_DEBUG_SOURCE_THIRD_PARTY: sourceStr = "Third Party"; break;
-        case GL_DEBUG_SOURCE_APPLICATION: sourceStr = "Application"; break;
-        case GL_DEBUG_SOURCE_OTHER: sourceStr = "Other"; break;
-        default: sourceStr = "Unknown"; break;
+      return true;
     }
+  }
 
-    const char* typeStr;
-    switch(type)
-    {
-        case GL_DEBUG_TYPE_ERROR: typeStr = "Error"; break;
-        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: typeStr = "Deprecated Behavior"; break;
-        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: typeStr = "Undefined Behavior"; break;
-        case GL_DEBUG_TYPE_PORTABILITY: typeStr = "Portability"; break;
-        case GL_DEBUG_TYPE_PERFORMANCE: typeStr = "Performance"; break;
-        case GL_DEBUG_TYPE_MARKER: typeStr = "Marker"; break;
-        case GL_DEBUG_TYPE_PUSH_GROUP: typeStr = "Push Group"; break;
-        case GL_DEBUG_TYPE_POP_GROUP: typeStr = "Pop Group"; break;
-        case GL_DEBUG_TYPE_OTHER: typeStr = "Other"; break;
-        default: typeStr = "Unknown"; break;
-    }
+  return false;
+}
 
-    const char* severityStr;
-    switch(severity)
+// Extends a rect of the block row above if it spans the same columns,
+// returns false if there is no room left
+bool add_texture_dirty_rect(TextureReload* reload, IRect rect)
+{
+  for(int rectIdx = 0; rectIdx < reload->dirtyRects.count; rectIdx++)
+  {
+    IRect* dirtyRect = &reload->dirtyRects[rectIdx];
+    if(dirtyRect->pos.x == rect.pos.x && dirtyRect->size.x == rect.size.x &&
+       dirtyRect->pos.y + dirtyRect->size.y == rect.pos.y)
     {
-        case GL_DEBUG_SEVERITY_HIGH: severityStr = "High"; break;
-        case GL_DEBUG_SEVERITY_MEDIUM: severityStr = "Medium"; break;
-        case GL_DEBUG_SEVERITY_LOW: severityStr = "Low"; break;
-        case GL_DEBUG_SEVERITY_NOTIFICATION: severityStr = "Notification"; break;
-        default: severityStr = "Unknown"; break;
+      dirtyRect->size.y += rect.size.y;
+      return true;
     }
+  }
 
-    printf("OpenGL Debug - Source: %s, Type: %s, ID: %u, Severity: %s\n", sourceStr, typeStr, id, severityStr);
-    printf("Message: %s\n", message);
+  if(reload->dirtyRects.is_full())
+  {
+    return false;
+  }
 
-    if(severity == GL_DEBUG_SEVERITY_HIGH)
+  reload->dirtyRects.add(rect);
+  return true;
+}
+
+// Changed blocks next to each other in a block row become one rect
+void find_texture_dirty_rects(TextureReload* reload)
+{
+  IVec2 size = reload->size;
+  for(int blockY = 0; blockY < size.y; blockY += TEXTURE_DIFF_BLOCK_SIZE)
+  {
+    int blockHeight = min(TEXTURE_DIFF_BLOCK_SIZE, size.y - blockY);
+    int runStart = -1;
+    for(int blockX = 0; blockX < size.x || runStart >= 0; blockX += TEXTURE_DIFF_BLOCK_SIZE)
     {
-        SM_ASSERT(false, "Critical OpenGL error");
+      bool changed = blockX < size.x && texture_block_changed(reload, blockX, blockY, blockHeight);
+      if(changed && runStart < 0)
+      {
+        runStart = blockX;
+      }
+      else if(!changed && runStart >= 0)
+      {
+        IRect rect = {{runStart, blockY}, {min(blockX, size.x) - runStart, blockHeight}};
+        if(!add_texture_dirty_rect(reload, rect))
+        {
+          reload->fullUpload = true;
+          return;
+        }
+        runStart = -1;
+      }
     }
+  }
 }
 
-GLuint gl_create_shader(int shaderType, char* shaderPath, BumpAllocator* transientStorage)
+// Runs on the decoder thread, started by gl_update_texture_reload()
+void decode_texture_reload(TextureReload* reload)
 {
+  char* filePaths[] = {(char*)TEXTURE_PATH};
+  wait_for_files_to_settle(filePaths, ArraySize(filePaths));
+
+  // The PNG is only needed while decoding, the thread's scratch memory is released with it
+  BumpAllocator* scratch = get_scratch_arena();
+  ScopedTempMemory tempMemory(scratch);
   int fileSize = 0;
-  char* shaderHeader = read_file("src/shader_header.h", &fileSize, transientStorage);
-  char* shaderSource = read_file(shaderPath, &fileSize, transientStorage);
+  char* file = read_file(TEXTURE_PATH, &fileSize, scratch);
+
+  int width = 0, height = 0, channels;
+  reload->newPixels = file? stbi_load_from_memory((unsigned char*)file, fileSize,
+                                                  &width, &height, &channels, 4) : nullptr;
+  reload->newSize = {width, height};
+  reload->dirtyRects.clear();
+  reload->fullUpload = !reload->pixels || width != reload->size.x || height != reload->size.y;
+  if(reload->newPixels && !reload->fullUpload)
+  {
+    find_texture_dirty_rects(reload);
+  }
+
+  reload->decodeDone.store(true, std::memory_order_release);
+}
 
-  if(!shaderHeader)
+// The rects are copied into the Pixel Buffer at their place in the image,
+// the copies into the texture then run on the GPU instead of blocking here
+void gl_upload_texture_rects(TextureReload* reload, IRect* rects, int rectCount)
+{
+  IVec2 size = reload->newSize;
+  int imageSize = size.x * size.y * 4;
+
+  // Orphaned, so this never waits for the last upload
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, reload->pixelBufferID);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, imageSize, nullptr, GL_STREAM_DRAW);
+  char* memory = (char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, imageSize, 
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if(!memory)
   {
-    SM_ASSERT(false, "Failed to load shader_header.h");
-    return 0;
+    SM_ASSERT(false, "Failed to map Pixel Buffer");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return;
   }
 
-  if(!shaderSource)
+  for(int rectIdx = 0; rectIdx < rectCount; rectIdx++)
   {
-    // SM_ASSERT(false, "Failed to load shader: %s",shaderPath);
-    SM_ERROR("Failed to load shader: %s. Error: %s", shaderPath, strerror(errno));
-    return 0;
+    IRect rect = rects[rectIdx];
+    for(int y = rect.pos.y; y < rect.pos.y + rect.size.y; y++)
+    {
+      int offset = (y * size.x + rect.pos.x) * 4;
+      memcpy(memory + offset, reload->newPixels + offset, rect.size.x * 4);
+    }
   }
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
 
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, glContext.textureID);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, size.x);
+  for(int rectIdx = 0; rectIdx < rectCount; rectIdx++)
+  {
+    IRect rect = rects[rectIdx];
+    size_t offset = ((size_t)rect.pos.y * size.x + rect.pos.x) * 4;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect.pos.x, rect.pos.y, rect.size.x, rect.size.y,
+                    GL_RGBA, GL_UNSIGNED_BYTE, (void*)offset);
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+  // Other uploads read from client memory
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
 
-  char* shaderSources[] =
+// Called once per frame, the PNG is decoded and compared on another thread,
+// only the changed rects are uploaded
+void gl_update_texture_reload()
+{
+  TextureReload* reload = &glContext.textureReload;
+  if(file_changed(glContext.textureWatchID))
   {
-    "#version 430 core\n",
-    shaderHeader,
-    shaderSource
-  };
+    reload->requested = true;
+  }
 
+  switch(reload->state)
+  {
+    case TEXTURE_RELOAD_IDLE:
+    {
+      if(reload->requested)
+      {
+        reload->requested = false;
+        reload->decodeDone.store(false, std::memory_order_relaxed);
+        if(reload->decoderThread.joinable())
+        {
+          reload->decoderThread.join();
+        }
+        reload->decoderThread = std::thread(decode_texture_reload, reload);
+        reload->state = TEXTURE_RELOAD_DECODING;
+      }
 
-  GLuint shaderID = glCreateShader(shaderType);
-  glShaderSource(shaderID, ArraySize(shaderSources), shaderSources, 0);
-  glCompileShader(shaderID);
+      break;
+    }
 
-  GLint compileStatus;
-  glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compileStatus);
-  if (compileStatus != GL_TRUE)
+    case TEXTURE_RELOAD_DECODING:
+    {
+      if(!reload->decodeDone.load(std::memory_order_acquire))
+      {
+        break;
+      }
+      reload->state = TEXTURE_RELOAD_IDLE;
+
+      if(!reload->newPixels)
+      {
+        SM_ERROR("Failed to reload Texture: %s", TEXTURE_PATH);
+        break;
+      }
+
+      if(reload->newSize.x != reload->size.x || reload->newSize.y != reload->size.y)
+      {
+        glDeleteTextures(1, &glContext.textureID);
+        glContext.textureID = gl_create_atlas_texture(reload->newSize);
+      }
+
+      if(reload->fullUpload)
+      {
+        IRect rect = {{0, 0}, reload->newSize};
+        gl_upload_texture_rects(reload, &rect, 1);
+      }
+      else
+      {
+        gl_upload_texture_rects(reload, reload->dirtyRects.elements, reload->dirtyRects.count);
+      }
+      SM_TRACE("Reloaded Texture, %s", reload->fullUpload? "full upload" : "changed rects only");
+
+      stbi_image_free(reload->pixels);
+      reload->pixels = reload->newPixels;
+      reload->size = reload->newSize;
+      reload->newPixels = nullptr;
+
+      break;
+    }
+  }
+}
+
+void gl_upload_font_atlas(char* pixels, int atlasSize)
+{
+  glGenTextures(1, (GLuint*)&glContext.fontAtlasID);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, glContext.fontAtlasID);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasSize, atlasSize, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// The atlas is uploaded straight from the mapped file
+bool load_font_cache(char* cachePath, uint64_t fontHash, int fontSize)
+{
+  if(!file_exists(cachePath))
   {
-      GLint logLength;
-      glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &logLength);
-      char* log = (char*)malloc(logLength);
-      glGetShaderInfoLog(shaderID, logLength, NULL, log);
-      
-      printf("Shader compilation failed for %s:\n%s\n", shaderPath, log);
-      
-      free(log);
-      glDeleteShader(shaderID);
-      return 0;
+    return false;
   }
 
-  return shaderID;
+  MappedFile cacheFile = map_file(cachePath);
+  FontCacheHeader* header = (FontCacheHeader*)cacheFile.data;
+  bool valid = cacheFile.data && cacheFile.size >= (long)sizeof(FontCacheHeader) &&
+               header->magic == FONT_CACHE_MAGIC && header->fontHash == fontHash &&
+               header->fontSize == fontSize && header->atlasSize > 0 &&
+               cacheFile.size == (long)sizeof(FontCacheHeader) + header->atlasSize * header->atlasSize;
+  if(valid)
+  {
+    renderData->fontHeight = max(header->fontHeight, renderData->fontHeight);
+    memcpy(renderData->glyphs, header->glyphs, sizeof(renderData->glyphs));
+    gl_upload_font_atlas(cacheFile.data + sizeof(FontCacheHeader), header->atlasSize);
+  }
+  else
+  {
+    SM_WARN("Invalid Font Cache: %s", cachePath);
+  }
+  unmap_file(&cacheFile);
+
+  return valid;
 }
 
-void load_font(char* filePath, int fontSize)
+// Rasterized atlases are cached by the hash of the font file and the size,
+// FreeType is only used on a miss
+void load_font(char* filePath, int fontSize, BumpAllocator* transientStorage)
 {
+  ScopedTempMemory tempMemory(transientStorage);
+
+  int fontFileSize = 0;
+  char* fontFile = read_file(filePath, &fontFileSize, transientStorage);
+  if(!fontFile)
+  {
+    SM_ASSERT(false, "Failed to load font: %s", filePath);
+    return;
+  }
+
+  uint64_t fontHash = hash_bytes(fontFile, fontFileSize);
+  char cachePath[256];
+  snprintf(cachePath, sizeof(cachePath), "%s/%016llx_%d.bin", FONT_CACHE_DIRECTORY, 
+           (unsigned long long)fontHash, fontSize);
+  if(load_font_cache(cachePath, fontHash, fontSize))
+  {
+    return;
+  }
+
   FT_Library fontLibrary;
   FT_Init_FreeType(&fontLibrary);
 
+  // The file is already in memory for the hash
   FT_Face fontFace;
-  FT_New_Face(fontLibrary, filePath, 0, &fontFace);
+  FT_New_Memory_Face(fontLibrary, (FT_Byte*)fontFile, fontFileSize, 0, &fontFace);
   FT_Set_Pixel_Sizes(fontFace, 0, fontSize);
 
   int padding = 2;
   int row = 0;
   int col = padding;
 
-  const int textureWidth = 512;
-  char textureBuffer[textureWidth * textureWidth];
+  // The atlas is written right behind the header, so it can be saved as is
+  const int textureWidth = FONT_ATLAS_SIZE;
+  int cacheFileSize = sizeof(FontCacheHeader) + textureWidth * textureWidth;
+  char* cacheFile = bump_alloc(transientStorage, cacheFileSize);
+  if(!cacheFile)
+  {
+    FT_Done_Face(fontFace);
+    FT_Done_FreeType(fontLibrary);
+    return;
+  }
+  memset(cacheFile, 0, cacheFileSize);
+  char* textureBuffer = cacheFile + sizeof(FontCacheHeader);
   for (FT_ULong glyphIdx = 32; glyphIdx < 127; ++glyphIdx)
   {
     FT_UInt glyphIndex = FT_Get_Char_Index(fontFace, glyphIdx);
@@ -200,17 +1330,35 @@ void load_font(char* filePath, int fontSize)
   FT_Done_Face(fontFace);
   FT_Done_FreeType(fontLibrary);
 
-  // Upload OpenGL Texture
+  // Font Cache
   {
-    glGenTextures(1, (GLuint*)&glContext.fontAtlasID);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, glContext.fontAtlasID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, textureWidth, textureWidth, 0, GL_RED, GL_UNSIGNED_BYTE, (char*)textureBuffer);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    FontCacheHeader* header = (FontCacheHeader*)cacheFile;
+    header->magic = FONT_CACHE_MAGIC;
+    header->fontSize = fontSize;
+    header->fontHash = fontHash;
+    header->atlasSize = textureWidth;
+    header->fontHeight = renderData->fontHeight;
+    memcpy(header->glyphs, renderData->glyphs, sizeof(header->glyphs));
+    write_file(cachePath, cacheFile, cacheFileSize);
   }
+
+  gl_upload_font_atlas(textureBuffer, textureWidth);
+}
+
+bool gl_has_extension(const char* name)
+{
+  GLint extensionCount = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+  for(int extensionIdx = 0; extensionIdx < extensionCount; extensionIdx++)
+  {
+    const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, extensionIdx);
+    if(extension && strcmp(extension, name) == 0)
+    {
+      return true;
+    }
+  }
+
+  return false;
 }
 
 bool gl_init(BumpAllocator* transientStorage)
@@ -231,91 +1379,121 @@ bool gl_init(BumpAllocator* transientStorage)
   glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
   glEnable(GL_DEBUG_OUTPUT);
 
-  GLuint vertShaderID = gl_create_shader(GL_VERTEX_SHADER, 
-                                         "assets/shaders/quad.vert", transientStorage);
-  GLuint fragShaderID = gl_create_shader(GL_FRAGMENT_SHADER, 
-                                         "assets/shaders/quad.frag", transientStorage);
-  if(!vertShaderID || !fragShaderID)
+  // Compiles started by the Shader Hot Reloading run on driver threads, 
+  // only loaded if available, loading a missing function asserts on Windows
+  if(gl_has_extension("GL_KHR_parallel_shader_compile"))
   {
-    SM_ASSERT(false, "Failed to create Shaders");
-    return false;
+    glMaxShaderCompilerThreadsKHR_ptr = 
+      (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)platform_load_gl_function("glMaxShaderCompilerThreadsKHR");
+  }
+  else if(gl_has_extension("GL_ARB_parallel_shader_compile"))
+  {
+    glMaxShaderCompilerThreadsKHR_ptr = 
+      (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)platform_load_gl_function("glMaxShaderCompilerThreadsARB");
+  }
+  if(glMaxShaderCompilerThreadsKHR_ptr)
+  {
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // As many as the driver wants
+    glContext.parallelShaderCompile = true;
   }
+  glContext.shaderReload.sourceStorage = make_virtual_bump_allocator(SHADER_RELOAD_STORAGE_SIZE);
 
-  long long timestampVert = get_timestamp("assets/shaders/quad.vert");
-  long long timestampFrag = get_timestamp("assets/shaders/quad.frag");
-  glContext.shaderTimestamp = max(timestampVert, timestampFrag);
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &glContext.programBinaryFormatCount);
+  if(glContext.programBinaryFormatCount && !create_directory(PROGRAM_CACHE_DIRECTORY))
+  {
+    glContext.programBinaryFormatCount = 0;
+  }
 
-  glContext.programID = glCreateProgram();
-  glAttachShader(glContext.programID, vertShaderID);
-  glAttachShader(glContext.programID, fragShaderID);
-  glLinkProgram(glContext.programID);
+  double programStartTime = platform_get_time();
+  bool quadProgramsCreated = gl_create_quad_programs(glContext.quadPrograms, transientStorage);
+  glContext.tileMapProgramID = gl_create_program("assets/shaders/tilemap.vert", 
+                                                 "assets/shaders/tilemap.frag", "", transientStorage);
+  if(!quadProgramsCreated || !glContext.tileMapProgramID)
+  {
+    SM_ASSERT(false, "Failed to create Shaders");
+    return false;
+  }
+  SM_TRACE("Created %d Programs in %.2f ms, %d from the Program Cache", SHADER_VARIANT_COUNT + 1,
+           (platform_get_time() - programStartTime) * 1000.0, glContext.cachedProgramCount);
 
-  glDetachShader(glContext.programID, vertShaderID);
-  glDetachShader(glContext.programID, fragShaderID);
-  glDeleteShader(vertShaderID);
-  glDeleteShader(fragShaderID);
+  glContext.vertShaderWatchID = watch_file("assets/shaders/quad.vert");
+  glContext.fragShaderWatchID = watch_file("assets/shaders/quad.frag");
 
   // This has to be done, otherwise OpenGL will not draw anything
   GLuint VAO;
   glGenVertexArrays(1, &VAO);
   glBindVertexArray(VAO);
 
-  // Texture Loading using STBI
+  // Quad Index Buffer, part of the VAO state, so it stays bound
+  {
+    // Corners from gl_VertexID: 0 Top Left, 1 Top Right, 2 Bottom Left, 3 Bottom Right
+    unsigned char quadIndices[6] = {0, 2, 1, 1, 2, 3};
+    glGenBuffers(1, &glContext.quadIndexBufferID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glContext.quadIndexBufferID);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quadIndices), quadIndices, GL_STATIC_DRAW);
+  }
+
+  // Texture Loading using STBI, the pixels are kept to diff against on Hot Reloading
   {
+    TextureReload* reload = &glContext.textureReload;
     int width, height, channels;
-    char* data = (char*)stbi_load(TEXTURE_PATH, &width, &height, &channels, 4);
-    if(!data)
+    reload->pixels = stbi_load(TEXTURE_PATH, &width, &height, &channels, 4);
+    if(!reload->pixels)
     {
       SM_ASSERT(false, "Failed to load texture");
       return false;
     }
+    reload->size = {width, height};
 
-    glGenTextures(1, &glContext.textureID);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, glContext.textureID);
-
-    // set the texture wrapping/filtering options (on the currently bound texture object)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    // This setting only matters when using the GLSL texture() function
-    // When you use texelFetch() this setting has no effect,
-    // because texelFetch is designed for this purpose
-    // See: https://interactiveimmersive.io/blog/glsl/glsl-data-tricks/
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 
-                 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glContext.textureTimestamp = get_timestamp(TEXTURE_PATH);
-
-    stbi_image_free(data);
+    glContext.textureID = gl_create_atlas_texture(reload->size);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, reload->pixels);
+    glGenBuffers(1, &reload->pixelBufferID);
+    glContext.textureWatchID = watch_file(TEXTURE_PATH);
   }
 
   // Load Font
   {
-    load_font("assets/fonts/AtariClassic-gry3.ttf", 8);
+    create_directory(FONT_CACHE_DIRECTORY);
+    load_font("assets/fonts/AtariClassic-gry3.ttf", 8, transientStorage);
   }
 
-  // Transform Storage Buffer
+  // Instance Storage Buffer, every chunk of game and UI Transforms gets its own
+  // range so nothing is overwritten while a draw call still reads it.
+  // Starts with room for one chunk each, grows in gl_render if needed
   {
-    glGenBuffers(1, &glContext.transformSBOID);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, glContext.transformSBOID);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Transform) * renderData->transforms.maxElements,
-                 renderData->transforms.elements, GL_DYNAMIC_DRAW);
+    int regionSize = 2 * sizeof(InstanceChunk::instances);
+    glContext.instanceBuffer = gl_create_stream_buffer(regionSize);
   }
 
-  // Materials Storage Buffer
+  // Materials Storage Buffer, new Materials are appended in gl_render
   {
     glGenBuffers(1, &glContext.materialSBOID);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, glContext.materialSBOID);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Material) * renderData->materials.maxElements,
-                 renderData->materials.elements, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, glContext.materialSBOID);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(Material) * MAX_MATERIALS, 
+                    nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_SBO_BINDING, glContext.materialSBOID);
+  }
+
+  // Render Layer Storage Buffers, updated by gl_upload_render_layers
+  {
+    glGenBuffers(MAX_RENDER_LAYERS, glContext.renderLayerSBOIDs);
+    for(int layerIdx = 0; layerIdx < MAX_RENDER_LAYERS; layerIdx++)
+    {
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, glContext.renderLayerSBOIDs[layerIdx]);
+      glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(InstanceData) * MAX_RENDER_LAYER_INSTANCES,
+                      nullptr, GL_DYNAMIC_STORAGE_BIT);
+    }
   }
 
-  // Uniforms
+  // Uniforms, the ones of the Quad Programs are looked up by gl_create_quad_programs
   {
-    glContext.screenSizeID = glGetUniformLocation(glContext.programID, "screenSize");
-    glContext.orthoProjectionID = glGetUniformLocation(glContext.programID, "orthoProjection");
+    GLuint tileMapProgramID = glContext.tileMapProgramID;
+    glContext.tileMapOrthoProjectionID = glGetUniformLocation(tileMapProgramID, "orthoProjection");
+    glContext.tileMapPosID = glGetUniformLocation(tileMapProgramID, "tileMapPos");
+    glContext.tileMapOffsetID = glGetUniformLocation(tileMapProgramID, "tileMapOffset");
+    glContext.tileMapSizeID = glGetUniformLocation(tileMapProgramID, "tileMapSize");
+    glContext.tileSizeID = glGetUniformLocation(tileMapProgramID, "tileSize");
+    glContext.tileAtlasCoordsID = glGetUniformLocation(tileMapProgramID, "tileAtlasCoords");
   }
   
   // sRGB output (even if input texture is non-sRGB -> don't rely on texture used)
@@ -329,173 +1507,198 @@ bool gl_init(BumpAllocator* transientStorage)
   glEnable(GL_DEPTH_TEST);
   glDepthFunc(GL_GREATER);
 
-  // Use Program
-  glUseProgram(glContext.programID);
+  // Used for translucent instances, enabled while they are drawn
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
   return true;
 }
 
-void gl_render(BumpAllocator* transientStorage)
+// Waits for the Hot Reloading threads, they still write into glContext
+void gl_shutdown()
 {
-  // Texture Hot Reloading
+  if(glContext.shaderReload.readerThread.joinable())
+  {
+    glContext.shaderReload.readerThread.join();
+  }
+  if(glContext.textureReload.decoderThread.joinable())
   {
-    long long currentTimestamp = get_timestamp(TEXTURE_PATH);
+    glContext.textureReload.decoderThread.join();
+  }
+}
 
-    if(currentTimestamp > glContext.textureTimestamp)
-    {    
-      glActiveTexture(GL_TEXTURE0);
-      int width, height, nChannels;
-      char* data = (char*)stbi_load(TEXTURE_PATH, &width, &height, &nChannels, 4);
-      if(data)
-      {
-        glContext.textureTimestamp = currentTimestamp;
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        stbi_image_free(data);
-      }
+// Has to be called while the simulation thread is idle
+void gl_upload_render_layers()
+{
+  RenderLayers* renderLayers = renderData->renderLayers;
+  for(int layerIdx = 0; layerIdx < renderLayers->count; layerIdx++)
+  {
+    RenderLayer* layer = &renderLayers->layers[layerIdx];
+    glContext.renderLayerDraws[layerIdx] = {layer->origin, layer->shaderVariant, layer->count};
+    if(layer->dirtyStart >= layer->dirtyEnd)
+    {
+      continue;
     }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, glContext.renderLayerSBOIDs[layerIdx]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(InstanceData) * layer->dirtyStart,
+                    sizeof(InstanceData) * (layer->dirtyEnd - layer->dirtyStart),
+                    &layer->instances[layer->dirtyStart]);
+    layer->dirtyStart = layer->dirtyEnd = 0;
   }
+  glContext.renderLayerCount = renderLayers->count;
+}
 
-  // Shader Hot Reloading
+// Has to be called while the simulation thread is idle
+void gl_upload_tile_map()
+{
+  TileMap* tileMap = renderData->tileMap;
+  if(!tileMap->active)
+  {
+    return;
+  }
+
+  glActiveTexture(GL_TEXTURE2);
+
+  // (Re)create the texture when the size changes, integer textures can't be filtered
+  if(!glContext.tileMapTextureID || 
+     glContext.tileMapTextureSize.x != tileMap->size.x || 
+     glContext.tileMapTextureSize.y != tileMap->size.y)
   {
-    long long timestampVert = get_timestamp("assets/shaders/quad.vert");
-    long long timestampFrag = get_timestamp("assets/shaders/quad.frag");
-    
-    if(timestampVert > glContext.shaderTimestamp ||
-       timestampFrag > glContext.shaderTimestamp)
+    if(!glContext.tileMapTextureID)
     {
-      // Add a small delay to allow file operations to complete
-      Sleep(100); // AVOID SLEEP IN PRODUCTION CODE
+      glGenTextures(1, &glContext.tileMapTextureID);
+    }
 
-      GLuint vertShaderID = gl_create_shader(GL_VERTEX_SHADER, 
-                                              "assets/shaders/quad.vert", transientStorage);
-      GLuint fragShaderID = gl_create_shader(GL_FRAGMENT_SHADER, 
-                                              "assets/shaders/quad.frag", transientStorage);
-      if(!vertShaderID || !fragShaderID)
-      {
-        SM_ASSERT(false, "Failed to create Shaders");
-        return;
-      }
-      
-      // This code creates an OpenGL shader program by:
-
-      // Creating a program object.
-      // Attaching vertex and fragment shaders to it.
-      // Linking the shaders into a complete program.
-      // Detaching and deleting the shaders to free up resources.
-      GLuint programID = glCreateProgram();
-      glAttachShader(programID, vertShaderID);
-      glAttachShader(programID, fragShaderID);
-      glLinkProgram(programID);
-      glDetachShader(programID, vertShaderID);
-      glDetachShader(programID, fragShaderID);
-      glDeleteShader(vertShaderID);
-      glDeleteShader(fragShaderID);
-
-      // Validate if program works
-      {
-        int programSuccess;
-        char programInfoLog[512];
-        glGetProgramiv(programID,GL_LINK_STATUS, &programSuccess);
+    glBindTexture(GL_TEXTURE_2D, glContext.tileMapTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, tileMap->size.x, tileMap->size.y, 
+                 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+    glContext.tileMapTextureSize = tileMap->size;
 
-        if(!programSuccess)
-        {
-          glGetProgramInfoLog(programID, 512, 0, programInfoLog);
-          
-          SM_ASSERT(0, "Failed to link program: %s", programInfoLog);
-          return;
-        }
-      }
-      glDeleteProgram(glContext.programID);
-      glContext.programID = programID;
-      glUseProgram(programID);
+    tileMap->dirtyMin = {};
+    tileMap->dirtyMax = tileMap->size;
+  }
 
-      glContext.shaderTimestamp = max(timestampVert, timestampFrag);
-    }
+  if(tileMap->dirtyMin.x < tileMap->dirtyMax.x)
+  {
+    // Rows are tightly packed bytes, the rect is part of them
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, tileMap->size.x);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, tileMap->dirtyMin.x, tileMap->dirtyMin.y, 
+                    tileMap->dirtyMax.x - tileMap->dirtyMin.x, tileMap->dirtyMax.y - tileMap->dirtyMin.y,
+                    GL_RED_INTEGER, GL_UNSIGNED_BYTE, 
+                    &tileMap->tiles[tileMap->dirtyMin.y * tileMap->size.x + tileMap->dirtyMin.x]);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    tileMap->dirtyMin = tileMap->dirtyMax = {};
+  }
+  glContext.tileMapPos = tileMap->pos;
+  glContext.tileMapOffset = tileMap->offset;
+  glContext.tileMapTileSize = tileMap->tileSize;
+
+  glActiveTexture(GL_TEXTURE0);
+
+  if(tileMap->atlasCoordsDirty)
+  {
+    glUseProgram(glContext.tileMapProgramID);
+    glUniform2iv(glContext.tileAtlasCoordsID, MAX_TILEMAP_ATLAS_COORDS, &tileMap->atlasCoords[0].x);
+    tileMap->atlasCoordsDirty = false;
   }
+}
+
+void gl_render(BumpAllocator* transientStorage)
+{
+  // Texture Hot Reloading
+  gl_update_texture_reload();
+
+  // Shader Hot Reloading
+  gl_update_shader_reload(transientStorage);
 
   glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
   glClearDepth(0.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glViewport(0, 0, input->screenSize.x, input->screenSize.y);
 
-  // Copy screen size to the GPU
-
-  {
-    struct Vec2
-    {
-      float x;
-      float y;
-    };
-    Vec2 screenSize = {(float)input->screenSize.x, (float)input->screenSize.y};
-    glUniform2fv(glContext.screenSizeID, 1, &screenSize.x);
-  }
-  
-  // Orthographic Projection
+  // Game Orthographic Projection, also used by the Tile Map
   OrthographicCamera2D camera = renderData->gameCamera;
   Mat4 orthoProjection = orthographic_projection(camera.position.x - camera.dimensions.x / 2.0f, 
                                                  camera.position.x + camera.dimensions.x / 2.0f, 
                                                  camera.position.y - camera.dimensions.y / 2.0f, 
                                                  camera.position.y + camera.dimensions.y / 2.0f);
-  glUniformMatrix4fv(glContext.orthoProjectionID, 1, GL_FALSE, &orthoProjection.ax);
 
-  // Opaque Objects
+  StreamBuffer* instanceBuffer = &glContext.instanceBuffer;
+  stream_buffer_reserve(instanceBuffer, stream_buffer_get_size(instanceBuffer, renderData));
+  stream_buffer_begin_frame(instanceBuffer);
 
+  // Copy new Materials to the GPU
   {
-    Vec2 screenSize = {(float)input->screenSize.x, (float)input->screenSize.y};
-    glUniform2fv(glContext.screenSizeID, 1, &screenSize.x);
+    MaterialTable* materialTable = renderData->materialTable;
+    int materialCount = materialTable->count.load(std::memory_order_acquire);
+    if(materialCount > glContext.uploadedMaterialCount)
+    {
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, glContext.materialSBOID);
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 
+                      sizeof(Material) * glContext.uploadedMaterialCount,
+                      sizeof(Material) * (materialCount - glContext.uploadedMaterialCount),
+                      &materialTable->materials[glContext.uploadedMaterialCount]);
+      glContext.uploadedMaterialCount = materialCount;
+    }
   }
 
-  // Copy Materials to the GPU
+  // Game Pass
   {
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, glContext.materialSBOID);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, 
-                    sizeof(Material) * renderData->materials.count,
-                    renderData->materials.elements);
-    renderData->materials.clear();
-  }
+    // Copy transforms to the GPU
+    gl_draw_instances(instanceBuffer, RENDER_PASS_GAME, OPACITY_OPAQUE, 
+                      &orthoProjection, renderData->transformOrigin);
 
-  // Bind back the Transform Buffer
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, glContext.transformSBOID);
+    // Retained Layers, one draw call each
+    for(int layerIdx = 0; layerIdx < glContext.renderLayerCount; layerIdx++)
+    {
+      RenderLayerDraw layer = glContext.renderLayerDraws[layerIdx];
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRANSFORM_SBO_BINDING, 
+                       glContext.renderLayerSBOIDs[layerIdx]);
+      gl_use_quad_program(layer.shaderVariant, &orthoProjection, layer.origin);
+      gl_draw_quads(layer.count);
+    }
 
-  // Game Pass
-  {
-    // Game Orthographic Projection
+    // Tile Map, a single quad, the texture exists once it was copied
+    if(glContext.tileMapTextureID)
     {
-      OrthographicCamera2D camera = renderData->gameCamera;
-      Mat4 orthoProjection = orthographic_projection(camera.position.x - camera.dimensions.x / 2.0f, 
-                                                    camera.position.x + camera.dimensions.x / 2.0f, 
-                                                    camera.position.y - camera.dimensions.y / 2.0f, 
-                                                    camera.position.y + camera.dimensions.y / 2.0f);
-      glUniformMatrix4fv(glContext.orthoProjectionID, 1, GL_FALSE, &orthoProjection.ax);
+      glUseProgram(glContext.tileMapProgramID);
+      glUniformMatrix4fv(glContext.tileMapOrthoProjectionID, 1, GL_FALSE, &orthoProjection.ax);
+      glUniform2fv(glContext.tileMapPosID, 1, &glContext.tileMapPos.x);
+      glUniform2iv(glContext.tileMapOffsetID, 1, &glContext.tileMapOffset.x);
+      glUniform2iv(glContext.tileMapSizeID, 1, &glContext.tileMapTextureSize.x);
+      glUniform1i(glContext.tileSizeID, glContext.tileMapTileSize);
+      gl_draw_quads(1);
     }
 
-    // Copy transforms to the GPU
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Transform) * renderData->transforms.count,
-                    renderData->transforms.elements);
-    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, renderData->transforms.count);
+    // Blended over the Layers and the Tile Map as well
+    gl_draw_instances(instanceBuffer, RENDER_PASS_GAME, OPACITY_TRANSLUCENT, 
+                      &orthoProjection, renderData->transformOrigin);
+
     // Reset for next Frame
-    renderData->transforms.count = 0;
+    renderData->transforms.clear();
   }
 
   // UI Pass
   {
     // UI Orthographic Projection
-    {
-      OrthographicCamera2D camera = renderData->uiCamera;
-      Mat4 orthoProjection = orthographic_projection(camera.position.x - camera.dimensions.x / 2.0f, 
-                                                    camera.position.x + camera.dimensions.x / 2.0f, 
-                                                    camera.position.y - camera.dimensions.y / 2.0f, 
-                                                    camera.position.y + camera.dimensions.y / 2.0f);
-      glUniformMatrix4fv(glContext.orthoProjectionID, 1, GL_FALSE, &orthoProjection.ax);
-    }
-
-    // Copy transforms to the GPU
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Transform) * renderData->uiTransforms.count,
-                    renderData->uiTransforms.elements);
+    OrthographicCamera2D camera = renderData->uiCamera;
+    Mat4 orthoProjection = orthographic_projection(camera.position.x - camera.dimensions.x / 2.0f, 
+                                                  camera.position.x + camera.dimensions.x / 2.0f, 
+                                                  camera.position.y - camera.dimensions.y / 2.0f, 
+                                                  camera.position.y + camera.dimensions.y / 2.0f);
 
-    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, renderData->uiTransforms.count);
+    // Copy transforms to the GPU, the UI Camera doesn't move
+    Vec2 uiOrigin = {};
+    gl_draw_instances(instanceBuffer, RENDER_PASS_UI, OPACITY_OPAQUE, &orthoProjection, uiOrigin);
+    gl_draw_instances(instanceBuffer, RENDER_PASS_UI, OPACITY_TRANSLUCENT, &orthoProjection, uiOrigin);
 
     // Reset for next Frame
-    renderData->uiTransforms.count = 0;
+    renderData->uiTransforms.clear();
   }
+
+  stream_buffer_end_frame(instanceBuffer);
 }
\ No newline at end of file
@@ -1,7 +1,8 @@
 #pragma once
 
 #include "../third_party/glcorearb.h"
-#include "win32_platform.cpp"
+#include "input.h"
+#include "platform.h"
 
 // #############################################################################
 //                           OpenGL Function Pointers
@@ -77,6 +78,23 @@ static PFNGLBLENDFUNCPROC glBlendFunc_ptr;
 static PFNGLFRONTFACEPROC glFrontFace_ptr;
 static PFNGLCLEARDEPTHPROC glClearDepth_ptr;
 static PFNGLGETSTRINGPROC glGetString_ptr;
+static PFNGLGETINTEGERVPROC glGetIntegerv_ptr;
+static PFNGLBUFFERSTORAGEPROC glBufferStorage_ptr;
+static PFNGLMAPBUFFERRANGEPROC glMapBufferRange_ptr;
+static PFNGLBINDBUFFERRANGEPROC glBindBufferRange_ptr;
+static PFNGLFENCESYNCPROC glFenceSync_ptr;
+static PFNGLCLIENTWAITSYNCPROC glClientWaitSync_ptr;
+static PFNGLDELETESYNCPROC glDeleteSync_ptr;
+static PFNGLTEXSUBIMAGE2DPROC glTexSubImage2D_ptr;
+static PFNGLPIXELSTOREIPROC glPixelStorei_ptr;
+static PFNGLUNIFORM2IVPROC glUniform2iv_ptr;
+static PFNGLPROGRAMPARAMETERIPROC glProgramParameteri_ptr;
+static PFNGLGETPROGRAMBINARYPROC glGetProgramBinary_ptr;
+static PFNGLPROGRAMBINARYPROC glProgramBinary_ptr;
+static PFNGLGETSTRINGIPROC glGetStringi_ptr;
+static PFNGLTEXSTORAGE2DPROC glTexStorage2D_ptr;
+static PFNGLUNMAPBUFFERPROC glUnmapBuffer_ptr;
+static PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR_ptr; // Optional, loaded by gl_init
 
 void load_gl_functions()
 {
@@ -151,6 +169,22 @@ void load_gl_functions()
   glDrawElementsInstanced_ptr = (PFNGLDRAWELEMENTSINSTANCEDPROC) platform_load_gl_function("glDrawElementsInstanced");
   glGenerateMipmap_ptr = (PFNGLGENERATEMIPMAPPROC) platform_load_gl_function("glGenerateMipmap");
   glDebugMessageCallback_ptr = (PFNGLDEBUGMESSAGECALLBACKPROC)platform_load_gl_function("glDebugMessageCallback");
+  glGetIntegerv_ptr = (PFNGLGETINTEGERVPROC) platform_load_gl_function("glGetIntegerv");
+  glBufferStorage_ptr = (PFNGLBUFFERSTORAGEPROC) platform_load_gl_function("glBufferStorage");
+  glMapBufferRange_ptr = (PFNGLMAPBUFFERRANGEPROC) platform_load_gl_function("glMapBufferRange");
+  glBindBufferRange_ptr = (PFNGLBINDBUFFERRANGEPROC) platform_load_gl_function("glBindBufferRange");
+  glFenceSync_ptr = (PFNGLFENCESYNCPROC) platform_load_gl_function("glFenceSync");
+  glClientWaitSync_ptr = (PFNGLCLIENTWAITSYNCPROC) platform_load_gl_function("glClientWaitSync");
+  glDeleteSync_ptr = (PFNGLDELETESYNCPROC) platform_load_gl_function("glDeleteSync");
+  glTexSubImage2D_ptr = (PFNGLTEXSUBIMAGE2DPROC) platform_load_gl_function("glTexSubImage2D");
+  glPixelStorei_ptr = (PFNGLPIXELSTOREIPROC) platform_load_gl_function("glPixelStorei");
+  glUniform2iv_ptr = (PFNGLUNIFORM2IVPROC) platform_load_gl_function("glUniform2iv");
+  glProgramParameteri_ptr = (PFNGLPROGRAMPARAMETERIPROC) platform_load_gl_function("glProgramParameteri");
+  glGetProgramBinary_ptr = (PFNGLGETPROGRAMBINARYPROC) platform_load_gl_function("glGetProgramBinary");
+  glProgramBinary_ptr = (PFNGLPROGRAMBINARYPROC) platform_load_gl_function("glProgramBinary");
+  glGetStringi_ptr = (PFNGLGETSTRINGIPROC) platform_load_gl_function("glGetStringi");
+  glTexStorage2D_ptr = (PFNGLTEXSTORAGE2DPROC) platform_load_gl_function("glTexStorage2D");
+  glUnmapBuffer_ptr = (PFNGLUNMAPBUFFERPROC) platform_load_gl_function("glUnmapBuffer");
 }
 
 // #############################################################################
@@ -508,4 +542,90 @@ void glClearDepth(GLdouble depth)
 const GLubyte* glGetString(GLenum name)
 {
     return glGetString_ptr(name);
-}
\ No newline at end of file
+}
+
+void glGetIntegerv(GLenum pname, GLint* data)
+{
+    glGetIntegerv_ptr(pname, data);
+}
+
+void glBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+    glBufferStorage_ptr(target, size, data, flags);
+}
+
+void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    return glMapBufferRange_ptr(target, offset, length, access);
+}
+
+void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    glBindBufferRange_ptr(target, index, buffer, offset, size);
+}
+
+GLsync glFenceSync(GLenum condition, GLbitfield flags)
+{
+    return glFenceSync_ptr(condition, flags);
+}
+
+GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    return glClientWaitSync_ptr(sync, flags, timeout);
+}
+
+void glDeleteSync(GLsync sync)
+{
+    glDeleteSync_ptr(sync);
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+                     GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+    glTexSubImage2D_ptr(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+void glPixelStorei(GLenum pname, GLint param)
+{
+    glPixelStorei_ptr(pname, param);
+}
+
+void glUniform2iv(GLint location, GLsizei count, const GLint* value)
+{
+    glUniform2iv_ptr(location, count, value);
+}
+
+void glProgramParameteri(GLuint program, GLenum pname, GLint value)
+{
+    glProgramParameteri_ptr(program, pname, value);
+}
+
+void glGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary)
+{
+    glGetProgramBinary_ptr(program, bufSize, length, binaryFormat, binary);
+}
+
+void glProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length)
+{
+    glProgramBinary_ptr(program, binaryFormat, binary, length);
+}
+
+const GLubyte* glGetStringi(GLenum name, GLuint index)
+{
+    return glGetStringi_ptr(name, index);
+}
+
+void glMaxShaderCompilerThreadsKHR(GLuint count)
+{
+    glMaxShaderCompilerThreadsKHR_ptr(count);
+}
+
+void glTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
+{
+    glTexStorage2D_ptr(target, levels, internalformat, width, height);
+}
+
+GLboolean glUnmapBuffer(GLenum target)
+{
+    return glUnmapBuffer_ptr(target);
+}
@@ -84,9 +84,89 @@ struct Key
   unsigned char halfTransitionCount;
 };
 
+enum InputEventType
+{
+  INPUT_EVENT_KEY,
+  INPUT_EVENT_MOUSE_MOVE,
+};
+
+struct InputEvent
+{
+  double time; // Seconds, platform_get_time() clock
+  InputEventType type;
+  KeyCodeID keyCode;
+  b8 isDown;
+  IVec2 mousePos;
+};
+
+// Ring Buffer, the Platform pushes, the Simulation consumes by tick time
+constexpr int MAX_INPUT_EVENTS = 256; // Has to be a power of 2
+struct InputEventQueue
+{
+  InputEvent events[MAX_INPUT_EVENTS];
+  unsigned int writeIdx;
+  unsigned int readIdx;
+  int droppedEventCount;
+
+  int count()
+  {
+    return writeIdx - readIdx;
+  }
+
+  // Fills up when the Simulation stalls. Only the newest Mouse Position matters,
+  // so a full queue merges it into the last Mouse Move, other Events are dropped
+  void push(InputEvent event)
+  {
+    if(count() == MAX_INPUT_EVENTS)
+    {
+      InputEvent* last = &events[(writeIdx - 1) & (MAX_INPUT_EVENTS - 1)];
+      if(event.type == INPUT_EVENT_MOUSE_MOVE && last->type == INPUT_EVENT_MOUSE_MOVE)
+      {
+        *last = event;
+        return;
+      }
+
+      droppedEventCount++;
+      SM_WARN("InputEventQueue full, dropped %s Event, %d so far", 
+              event.type == INPUT_EVENT_KEY? "Key" : "Mouse", droppedEventCount);
+      return;
+    }
+
+    events[writeIdx++ & (MAX_INPUT_EVENTS - 1)] = event;
+  }
+
+  InputEvent* peek()
+  {
+    return count()? &events[readIdx & (MAX_INPUT_EVENTS - 1)] : nullptr;
+  }
+
+  InputEvent pop()
+  {
+    SM_ASSERT(count(), "InputEventQueue empty!");
+    return events[readIdx++ & (MAX_INPUT_EVENTS - 1)];
+  }
+};
+
+// Filled by the engine every frame, see frame_pacer.h
+constexpr int FRAME_STATS_SAMPLE_COUNT = 120;
+struct FrameStats
+{
+  float targetFrameTime; // 0 means paced by Vsync
+  float frameTime;       // Last frame, including waiting
+  float workTime;        // Last frame, without waiting
+  float avgFrameTime;    // Over the last FRAME_STATS_SAMPLE_COUNT frames
+  float minFrameTime;
+  float maxFrameTime;
+  float fps;
+  int frameCount;
+  int missedFrames;      // Frames where the work took longer than the target
+};
+
 struct Input
 {
   IVec2 screenSize;
+  double time; // When this frame was started, same clock as InputEvent::time
+  b8 chunkSavingOff; // Set by the Platform, BREAKOUT_SAVE_DIRECTORY still turns it on
 
   // Screen
   IVec2 prevMousePos;
@@ -99,6 +179,9 @@ struct Input
   IVec2 relMouseWorld;
 
   Key keys[KEY_COUNT];
+
+  InputEventQueue events;
+  FrameStats frameStats;
 };
 
 
@@ -110,6 +193,27 @@ static Input* input;
 // #############################################################################
 //                           Input Functions
 // #############################################################################
+void push_key_event(double time, KeyCodeID keyCode, bool isDown)
+{
+  InputEvent event = {};
+  event.time = time;
+  event.type = INPUT_EVENT_KEY;
+  event.keyCode = keyCode;
+  event.isDown = isDown;
+
+  input->events.push(event);
+}
+
+void push_mouse_event(double time, IVec2 mousePos)
+{
+  InputEvent event = {};
+  event.time = time;
+  event.type = INPUT_EVENT_MOUSE_MOVE;
+  event.mousePos = mousePos;
+
+  input->events.push(event);
+}
+
 bool key_pressed_this_frame(KeyCodeID keyCode)
 {
     Key key = input->keys[keyCode];
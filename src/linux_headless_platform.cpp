@@ -0,0 +1,553 @@
+#ifndef LINUX_HEADLESS_PLATFORM_H
+#define LINUX_HEADLESS_PLATFORM_H
+
+#include "platform.h"
+#include "breaknotes_lib.h"
+#include "input.h"
+
+#include <dlfcn.h>
+#include <time.h>
+
+// File watching / copying
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <sys/sendfile.h>
+#include <thread>
+
+#ifndef GL_GLEXT_PROTOTYPES
+  #define GL_GLEXT_PROTOTYPES
+#endif
+#include "../third_party/glcorearb.h"
+
+// #############################################################################
+//                           Headless Constants
+// #############################################################################
+// The headless backend runs on a virtual clock, every frame advances
+// time by exactly this much, so benchmark runs are reproducible
+constexpr double HEADLESS_FRAME_TIME = 1.0 / 60.0;
+
+// How many frames to run before shutting down, can be overwritten
+// with the BREAKOUT_HEADLESS_FRAMES environment variable
+constexpr int HEADLESS_DEFAULT_FRAME_COUNT = 10000;
+
+// Same seed every run, so a failing random script can be replayed
+constexpr uint32_t HEADLESS_RANDOM_SEED = 0x2545F491;
+
+// #############################################################################
+//                           Headless Structs
+// #############################################################################
+enum HeadlessInputEventType
+{
+  HEADLESS_INPUT_KEY,
+  HEADLESS_INPUT_MOUSE_MOVE,
+};
+
+struct HeadlessInputEvent
+{
+  HeadlessInputEventType type;
+  int frame;             // Frame on which the event gets applied
+  KeyCodeID keyCode;
+  bool isDown;
+  IVec2 mousePos;
+};
+
+// #############################################################################
+//                           Headless Globals
+// #############################################################################
+static Array<HeadlessInputEvent, 8192> headlessInputEvents;
+static int headlessInputEventIdx;
+static int headlessFrame;
+static int headlessFrameCount = HEADLESS_DEFAULT_FRAME_COUNT;
+static double headlessVirtualTime;
+static timespec headlessStartTime;
+
+// #############################################################################
+//                           Headless Input Injection
+// #############################################################################
+// Events have to be pushed in frame order, they are consumed front to back
+void platform_headless_push_key(int frame, KeyCodeID keyCode, bool isDown)
+{
+  HeadlessInputEvent event = {};
+  event.type = HEADLESS_INPUT_KEY;
+  event.frame = frame;
+  event.keyCode = keyCode;
+  event.isDown = isDown;
+  headlessInputEvents.add(event);
+}
+
+void platform_headless_push_mouse(int frame, IVec2 mousePos)
+{
+  HeadlessInputEvent event = {};
+  event.type = HEADLESS_INPUT_MOUSE_MOVE;
+  event.frame = frame;
+  event.mousePos = mousePos;
+  headlessInputEvents.add(event);
+}
+
+// Default benchmark scenario, walks the player around and
+// paints / erases tiles across the whole screen
+void headless_push_default_input_script(int width, int height)
+{
+  int stepFrames = 8;
+  int steps = min(headlessFrameCount / stepFrames,
+                  headlessInputEvents.maxElements / 2 - 4);
+
+  platform_headless_push_key(0, KEY_D, true);
+  platform_headless_push_key(0, KEY_MOUSE_LEFT, true);
+
+  for(int step = 0; step < steps; step++)
+  {
+    int frame = step * stepFrames;
+
+    // Sweep the mouse row by row over the screen
+    IVec2 mousePos = {};
+    mousePos.x = (step * 37) % width;
+    mousePos.y = ((step * 37) / width * 23) % height;
+    platform_headless_push_mouse(frame, mousePos);
+
+    if(step == steps / 2)
+    {
+      platform_headless_push_key(frame, KEY_MOUSE_LEFT, false);
+      platform_headless_push_key(frame, KEY_MOUSE_RIGHT, true);
+      platform_headless_push_key(frame, KEY_D, false);
+      platform_headless_push_key(frame, KEY_A, true);
+    }
+  }
+}
+
+// Xorshift, good enough to scatter the edits
+uint32_t headless_random(uint32_t* state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// Autotiling test scenario, selected with BREAKOUT_HEADLESS_SCRIPT=random_edits.
+// Random strokes of painting and erasing, while the player walks a square
+// that is too large to stay resident, so Chunks get evicted, saved and loaded
+// again. The masks are only compared if the game is built with
+// AUTOTILE_SELF_CHECK, see verify_autotiling()
+void headless_push_random_edit_script(int width, int height)
+{
+  uint32_t randomState = HEADLESS_RANDOM_SEED;
+  int stepFrames = 3;
+  int strokeSteps = 32;
+  int sideFrames = 1024; // About 8 Chunks
+  int steps = min(headlessFrameCount / stepFrames,
+                  headlessInputEvents.maxElements / 2 - 8);
+
+  KeyCodeID moveKeys[] = {KEY_D, KEY_S, KEY_A, KEY_W};
+  int side = 0;
+  bool leftDown = false;
+  bool rightDown = false;
+  platform_headless_push_key(0, moveKeys[side], true);
+
+  IVec2 strokeCenter = {width / 2, height / 2};
+  for(int step = 0; step < steps; step++)
+  {
+    int frame = step * stepFrames;
+
+    if(frame / sideFrames != side)
+    {
+      platform_headless_push_key(frame, moveKeys[side % ArraySize(moveKeys)], false);
+      side = frame / sideFrames;
+      platform_headless_push_key(frame, moveKeys[side % ArraySize(moveKeys)], true);
+    }
+
+    // A new stroke paints, erases, does both or neither somewhere else
+    if(step % strokeSteps == 0)
+    {
+      uint32_t choice = headless_random(&randomState);
+      strokeCenter = {(int)(headless_random(&randomState) % width),
+                      (int)(headless_random(&randomState) % height)};
+      bool left = choice & 1;
+      bool right = choice & 2;
+      if(left != leftDown)
+      {
+        platform_headless_push_key(frame, KEY_MOUSE_LEFT, left);
+        leftDown = left;
+      }
+      if(right != rightDown)
+      {
+        platform_headless_push_key(frame, KEY_MOUSE_RIGHT, right);
+        rightDown = right;
+      }
+    }
+
+    // Dabs close to the center fill whole blobs, the masks of enclosed Tiles
+    // also depend on the Tiles two away
+    uint32_t offset = headless_random(&randomState);
+    IVec2 mousePos = {};
+    mousePos.x = min(max(strokeCenter.x + (int)(offset % 161) - 80, 0), width - 1);
+    mousePos.y = min(max(strokeCenter.y + (int)((offset >> 8) % 161) - 80, 0), height - 1);
+    platform_headless_push_mouse(frame, mousePos);
+  }
+}
+
+// #############################################################################
+//                           Headless OpenGL
+// #############################################################################
+// There is no GPU, so every GL function resolves to a stub. The ones
+// the renderer reads results from are implemented, everything else is
+// a no-op. Calling a function without parameters through a pointer with
+// parameters is fine on the x64 / arm64 calling conventions we target.
+static GLuint headlessGLObjectID;
+
+static void APIENTRY headless_gl_noop()
+{
+}
+
+static GLuint APIENTRY headless_gl_create()
+{
+  return ++headlessGLObjectID;
+}
+
+static void APIENTRY headless_gl_gen(GLsizei n, GLuint* objects)
+{
+  for(int idx = 0; idx < n; idx++)
+  {
+    objects[idx] = ++headlessGLObjectID;
+  }
+}
+
+static void APIENTRY headless_gl_get_iv(GLuint object, GLenum pname, GLint* params)
+{
+  *params = (pname == GL_INFO_LOG_LENGTH)? 0 : GL_TRUE;
+}
+
+static GLint APIENTRY headless_gl_get_location(GLuint program, const GLchar* name)
+{
+  return 0;
+}
+
+static GLenum APIENTRY headless_gl_check_framebuffer_status(GLenum target)
+{
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static const GLubyte* APIENTRY headless_gl_get_string(GLenum name)
+{
+  return (const GLubyte*)"Headless";
+}
+
+static void APIENTRY headless_gl_get_integerv(GLenum pname, GLint* data)
+{
+  *data = (pname == GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT)? 256 : 0;
+}
+
+// Mapped buffers live for the whole run, so they are never freed
+static void* APIENTRY headless_gl_map_buffer_range(GLenum target, GLintptr offset,
+                                                   GLsizeiptr length, GLbitfield access)
+{
+  return calloc(1, length);
+}
+
+static GLsync APIENTRY headless_gl_fence_sync(GLenum condition, GLbitfield flags)
+{
+  return (GLsync)(size_t)++headlessGLObjectID;
+}
+
+static GLenum APIENTRY headless_gl_client_wait_sync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+  return GL_ALREADY_SIGNALED;
+}
+
+// #############################################################################
+//                           Platform Implementations
+// #############################################################################
+bool platform_create_window(int width, int height, char* title)
+{
+  char* frameCount = getenv("BREAKOUT_HEADLESS_FRAMES");
+  if(frameCount)
+  {
+    headlessFrameCount = atoi(frameCount);
+  }
+
+  // Every run starts from an empty world, so benchmarks are reproducible.
+  // Setting BREAKOUT_SAVE_DIRECTORY saves the Chunks there instead
+  input->chunkSavingOff = true;
+
+  input->screenSize.x = width;
+  input->screenSize.y = height;
+
+  if(!headlessInputEvents.count)
+  {
+    char* script = getenv("BREAKOUT_HEADLESS_SCRIPT");
+    if(script && strcmp(script, "random_edits") == 0)
+    {
+      headless_push_random_edit_script(width, height);
+    }
+    else
+    {
+      headless_push_default_input_script(width, height);
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &headlessStartTime);
+  SM_TRACE("Headless Platform: %s, %dx%d, %d Frames", title, width, height, headlessFrameCount);
+
+  return true;
+}
+
+void platform_update_window()
+{
+  // Post the injected Input for this Frame, it happened at the start of the Frame
+  double eventTime = headlessVirtualTime - HEADLESS_FRAME_TIME;
+  while(headlessInputEventIdx < headlessInputEvents.count &&
+        headlessInputEvents[headlessInputEventIdx].frame <= headlessFrame)
+  {
+    HeadlessInputEvent event = headlessInputEvents[headlessInputEventIdx++];
+
+    switch(event.type)
+    {
+      case HEADLESS_INPUT_KEY:
+      {
+        push_key_event(eventTime, event.keyCode, event.isDown);
+
+        break;
+      }
+
+      case HEADLESS_INPUT_MOUSE_MOVE:
+      {
+        input->mousePos = event.mousePos;
+        push_mouse_event(eventTime, event.mousePos);
+
+        break;
+      }
+    }
+  }
+
+  // Mouse Position World
+  input->mousePosWorld = screen_to_world(input->mousePos);
+}
+
+void* platform_load_gl_function(char* funName)
+{
+  struct
+  {
+    char* name;
+    void* proc;
+  } stubs[] =
+  {
+    {"glCreateProgram", (void*)headless_gl_create},
+    {"glCreateShader", (void*)headless_gl_create},
+    {"glGenTextures", (void*)headless_gl_gen},
+    {"glGenBuffers", (void*)headless_gl_gen},
+    {"glGenVertexArrays", (void*)headless_gl_gen},
+    {"glGenFramebuffers", (void*)headless_gl_gen},
+    {"glGetShaderiv", (void*)headless_gl_get_iv},
+    {"glGetProgramiv", (void*)headless_gl_get_iv},
+    {"glGetUniformLocation", (void*)headless_gl_get_location},
+    {"glGetAttribLocation", (void*)headless_gl_get_location},
+    {"glCheckFramebufferStatus", (void*)headless_gl_check_framebuffer_status},
+    {"glGetString", (void*)headless_gl_get_string},
+    {"glGetIntegerv", (void*)headless_gl_get_integerv},
+    {"glMapBufferRange", (void*)headless_gl_map_buffer_range},
+    {"glFenceSync", (void*)headless_gl_fence_sync},
+    {"glClientWaitSync", (void*)headless_gl_client_wait_sync},
+  };
+
+  for(int idx = 0; idx < ArraySize(stubs); idx++)
+  {
+    if(strcmp(stubs[idx].name, funName) == 0)
+    {
+      return stubs[idx].proc;
+    }
+  }
+
+  return (void*)headless_gl_noop;
+}
+
+void platform_swap_buffers()
+{
+  headlessFrame++;
+  headlessVirtualTime += HEADLESS_FRAME_TIME;
+
+  if(headlessFrame >= headlessFrameCount)
+  {
+    timespec endTime = {};
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    double seconds = (double)(endTime.tv_sec - headlessStartTime.tv_sec) +
+                     (double)(endTime.tv_nsec - headlessStartTime.tv_nsec) / 1000000000.0;
+
+    SM_TRACE("Headless Run: %d Frames, %.2fs virtual, %.3fs wall, %.1f FPS, %.3fus per Frame",
+             headlessFrame, headlessVirtualTime, seconds,
+             headlessFrame / seconds, seconds * 1000000.0 / headlessFrame);
+    running = false;
+  }
+}
+
+bool platform_set_vsync(bool vSync)
+{
+  // Nothing to present, reporting success keeps the frame pacer
+  // from waiting, frames run as fast as possible
+  return true;
+}
+
+void* platform_load_dynamic_library(char* dll)
+{
+  void* result = dlopen(dll, RTLD_NOW);
+  SM_ASSERT(result, "Failed to load Library: %s, %s", dll, dlerror());
+
+  return result;
+}
+
+void* platform_load_dynamic_function(void* dll, char* funName)
+{
+  void* proc = dlsym(dll, funName);
+  SM_ASSERT(proc, "Failed to load function: %s", funName);
+
+  return proc;
+}
+
+bool platform_free_dynamic_library(void* dll)
+{
+  int freeResult = dlclose(dll);
+  SM_ASSERT(!freeResult, "Failed to free Library, %s", dlerror());
+
+  return !freeResult;
+}
+
+void platform_fill_keycode_lookup_table()
+{
+  // Injected Input already uses KeyCodeIDs
+  for(int keyCode = 0; keyCode < KEY_COUNT; keyCode++)
+  {
+    KeyCodeLookupTable[keyCode] = (KeyCodeID)keyCode;
+  }
+}
+
+void platform_sleep(unsigned int ms)
+{
+  timespec duration = {};
+  duration.tv_sec = ms / 1000;
+  duration.tv_nsec = (long)(ms % 1000) * 1000000;
+  nanosleep(&duration, nullptr);
+}
+
+double platform_get_time()
+{
+  return headlessVirtualTime;
+}
+
+
+bool platform_copy_file(char* fileName, char* outputName)
+{
+  int inputFile = open(fileName, O_RDONLY);
+  if(inputFile < 0)
+  {
+    SM_ERROR("Failed opening File: %s", fileName);
+    return false;
+  }
+
+  struct stat fileStat = {};
+  fstat(inputFile, &fileStat);
+
+  // Write a new file instead of truncating, the old one might still be mapped (dlopen)
+  unlink(outputName);
+  int outputFile = open(outputName, O_WRONLY | O_CREAT | O_TRUNC, fileStat.st_mode & 0777);
+  if(outputFile < 0)
+  {
+    SM_ERROR("Failed opening File: %s", outputName);
+    close(inputFile);
+    return false;
+  }
+
+  // Copy inside the Kernel, the data never goes through our memory
+  off_t remaining = fileStat.st_size;
+  while(remaining > 0)
+  {
+    ssize_t copied = copy_file_range(inputFile, nullptr, outputFile, nullptr, remaining, 0);
+
+    // Older Kernels / some file systems can't do it, sendfile is still in Kernel
+    if(copied < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL))
+    {
+      copied = sendfile(outputFile, inputFile, nullptr, remaining);
+    }
+
+    if(copied <= 0)
+    {
+      break;
+    }
+
+    remaining -= copied;
+  }
+
+  close(inputFile);
+  close(outputFile);
+
+  return remaining == 0;
+}
+
+void linux_file_watcher_thread(int inotifyFD, int* watchDescriptors)
+{
+  alignas(inotify_event) char buffer[4096];
+
+  while(true)
+  {
+    ssize_t length = read(inotifyFD, buffer, sizeof(buffer));
+    if(length <= 0)
+    {
+      if(length < 0 && errno == EINTR)
+      {
+        continue;
+      }
+
+      SM_ERROR("File Watcher stopped, %s", strerror(errno));
+      return;
+    }
+
+    for(char* ptr = buffer; ptr < buffer + length;)
+    {
+      inotify_event* event = (inotify_event*)ptr;
+
+      for(int watchID = 0; watchID < fileWatcher.files.count; watchID++)
+      {
+        if(event->len && watchDescriptors[watchID] == event->wd &&
+           strcmp(event->name, fileWatcher.files[watchID].fileName) == 0)
+        {
+          post_file_change(watchID);
+        }
+      }
+
+      ptr += sizeof(inotify_event) + event->len;
+    }
+  }
+}
+
+bool platform_start_file_watcher()
+{
+  static int watchDescriptors[MAX_WATCHED_FILES];
+
+  int inotifyFD = inotify_init1(IN_CLOEXEC);
+  if(inotifyFD < 0)
+  {
+    SM_ERROR("Failed to initialize inotify, %s", strerror(errno));
+    return false;
+  }
+
+  // Watching the same directory twice returns the same descriptor
+  for(int watchID = 0; watchID < fileWatcher.files.count; watchID++)
+  {
+    watchDescriptors[watchID] = inotify_add_watch(inotifyFD, fileWatcher.files[watchID].directory,
+                                                  IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(watchDescriptors[watchID] < 0)
+    {
+      SM_ERROR("Failed to watch: %s, %s", fileWatcher.files[watchID].path, strerror(errno));
+    }
+  }
+
+  fileWatcher.started = true;
+  std::thread(linux_file_watcher_thread, inotifyFD, watchDescriptors).detach();
+
+  return true;
+}
+
+
+#endif // LINUX_HEADLESS_PLATFORM_H
@@ -8,6 +8,9 @@
     #ifndef APIENTRY
         #define APIENTRY __stdcall
     #endif
+#elif defined(__linux__)
+    #define APIENTRY
+    #include "linux_headless_platform.cpp"
 #else
     #define APIENTRY
 #endif
@@ -21,6 +24,7 @@
 #include "platform.h"
 
 #include "gl_renderer.cpp"
+#include "frame_pacer.h"
 
 // #############################################################################
 //                           Game DLL Stuff
@@ -29,18 +33,68 @@
 typedef decltype(update_game) update_game_type;
 static update_game_type* update_game_ptr;
 
+#ifdef _WIN32
+const char* GAME_DLL_PATH = "game.dll";
+const char* GAME_LOAD_DLL_PATH = "game_load.dll";
+#else
+const char* GAME_DLL_PATH = "./game.so";
+const char* GAME_LOAD_DLL_PATH = "./game_load.so";
+#endif
+
+static int gameDLLWatchID;
+
+// #############################################################################
+//                           Frame Pacing
+// #############################################################################
+// 0 uses Vsync, anything else disables Vsync and waits for the target rate
+constexpr int TARGET_FPS = 0;
+// Used when Vsync is not available
+constexpr int FALLBACK_TARGET_FPS = 60;
+
+static FramePacer framePacer;
+
+// #############################################################################
+//                           Simulation Thread
+// #############################################################################
+// update_game runs on its own thread, one frame ahead of rendering.
+// Finished frames are handed to the renderer through renderDataBuffer.
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct SimulationThread
+{
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool frameRequested;
+  bool quit;
+  float dt;
+
+  Input* input; // Copy of the platform Input, owned by the simulation
+};
+
+static SimulationThread simulation;
+static TripleBuffer<RenderData> renderDataBuffer;
+
 // #############################################################################
 //                           Cross Platform functions
 // #############################################################################
-#include <chrono>
-double get_delta_time();
-void reload_game_dll(BumpAllocator* transientStorage);
+double get_delta_time(double time);
+void reload_game_dll();
+void simulation_thread();
+void start_simulation(double time, float dt);
+void wait_for_simulation();
 
 
 int main()
 {
-  BumpAllocator transientStorage = make_bump_allocator(MB(50));
-  BumpAllocator persistentStorage = make_bump_allocator(MB(50));
+  // Formatting and writing log messages happens on a background thread
+  start_log_thread();
+
+  // Only address space is reserved, pages are committed when they are first used
+  BumpAllocator transientStorage = make_virtual_bump_allocator(MB(50), BUMP_ALLOCATOR_GUARD_PAGE);
+  BumpAllocator persistentStorage = make_virtual_bump_allocator(MB(50), BUMP_ALLOCATOR_GUARD_PAGE);
 
   input = (Input*)bump_alloc(&persistentStorage, sizeof(Input));
   if(!input)
@@ -49,13 +103,62 @@ int main()
     return -1;
   }
 
-  renderData = (RenderData*)bump_alloc(&persistentStorage, sizeof(RenderData));
-  if(!renderData)
+  simulation.input = (Input*)bump_alloc(&persistentStorage, sizeof(Input));
+  if(!simulation.input)
+  {
+    SM_ERROR("Failed to allocate Simulation Input");
+    return -1;
+  }
+
+  for(int bufferIdx = 0; bufferIdx < ArraySize(renderDataBuffer.buffers); bufferIdx++)
+  {
+    RenderData* buffer = (RenderData*)bump_alloc(&persistentStorage, sizeof(RenderData));
+    if(!buffer)
+    {
+      SM_ERROR("Failed to allocate RenderData");
+      return -1;
+    }
+
+    buffer->frameArena = make_virtual_bump_allocator(FRAME_ARENA_SIZE, BUMP_ALLOCATOR_GUARD_PAGE);
+    if(!buffer->frameArena.memory)
+    {
+      SM_ERROR("Failed to allocate Frame Arena");
+      return -1;
+    }
+    buffer->transforms.arena = &buffer->frameArena;
+    buffer->uiTransforms.arena = &buffer->frameArena;
+    renderDataBuffer.buffers[bufferIdx] = buffer;
+  }
+  renderData = renderDataBuffer.read_buffer();
+
+  MaterialTable* materialTable = (MaterialTable*)bump_alloc(&persistentStorage, sizeof(MaterialTable));
+  if(!materialTable)
+  {
+    SM_ERROR("Failed to allocate MaterialTable");
+    return -1;
+  }
+
+  RenderLayers* renderLayers = (RenderLayers*)bump_alloc(&persistentStorage, sizeof(RenderLayers));
+  if(!renderLayers)
+  {
+    SM_ERROR("Failed to allocate RenderLayers");
+    return -1;
+  }
+
+  TileMap* tileMap = (TileMap*)bump_alloc(&persistentStorage, sizeof(TileMap));
+  if(!tileMap)
   {
-    SM_ERROR("Failed to allocate RenderData");
+    SM_ERROR("Failed to allocate TileMap");
     return -1;
   }
 
+  for(int bufferIdx = 0; bufferIdx < ArraySize(renderDataBuffer.buffers); bufferIdx++)
+  {
+    renderDataBuffer.buffers[bufferIdx]->materialTable = materialTable;
+    renderDataBuffer.buffers[bufferIdx]->renderLayers = renderLayers;
+    renderDataBuffer.buffers[bufferIdx]->tileMap = tileMap;
+  }
+
   gameState = (GameState*)bump_alloc(&persistentStorage, sizeof(GameState));
   if(!gameState)
   {
@@ -65,28 +168,85 @@ int main()
 
   platform_fill_keycode_lookup_table();
   platform_create_window(1280, 720, "Breakout");
-  platform_set_vsync(true);
+  set_target_fps(&framePacer, TARGET_FPS);
+  if(!platform_set_vsync(!TARGET_FPS) && !TARGET_FPS)
+  {
+    SM_WARN("Vsync not available, pacing to %d FPS", FALLBACK_TARGET_FPS);
+    set_target_fps(&framePacer, FALLBACK_TARGET_FPS);
+  }
 
   gl_init(&transientStorage);
 
+  // Fonts were loaded into the first buffer, every snapshot needs them
+  for(int bufferIdx = 0; bufferIdx < ArraySize(renderDataBuffer.buffers); bufferIdx++)
+  {
+    // Only the fonts, every buffer keeps its own Frame Arena
+    RenderData* buffer = renderDataBuffer.buffers[bufferIdx];
+    buffer->fontHeight = renderData->fontHeight;
+    memcpy(buffer->glyphs, renderData->glyphs, sizeof(buffer->glyphs));
+  }
+
+  // Hot Reloading, changes are reported by a background thread
+  gameDLLWatchID = watch_file(GAME_DLL_PATH);
+  if(!platform_start_file_watcher())
+  {
+    SM_WARN("Failed to start File Watcher, Hot Reloading is disabled");
+  }
+
+  simulation.thread = std::thread(simulation_thread);
+
+  // Totals of the per frame CullStats
+  long long submittedQuads = 0;
+  long long culledQuads = 0;
+
   while(running)
   {
-    float dt = get_delta_time();
-    reload_game_dll(&transientStorage);
+    drain_file_changes();
+
+    // The Simulation is idle until it gets the next frame
+    wait_for_simulation();
+    reload_game_dll();
+
+    // The Simulation is idle, so the Render Layers and Tile Map can be read safely
+    gl_upload_render_layers();
+    gl_upload_tile_map();
 
     // Update
     platform_update_window();
-    update_game(gameState, renderData, input, dt);
+    double time = platform_get_time();
+    start_simulation(time, get_delta_time(time));
+
+    // Render the newest finished frame, while the next one is simulated
+    renderData = renderDataBuffer.read_buffer();
 
     // Debug print
-    SM_TRACE("Current FPS: %.1f", gameState->currentFps);
-    
+    SM_TRACE("Current FPS: %.1f", renderData->currentFps);
+    submittedQuads += renderData->cullStats.submittedQuads;
+    culledQuads += renderData->cullStats.culledQuads;
     gl_render(&transientStorage);
 
     platform_swap_buffers();
+    frame_pacer_end_frame(&framePacer);
+
+    bump_allocator_reset(&transientStorage);
+  }
 
-    transientStorage.used = 0;
+  SM_TRACE("Quads: %lld submitted, %lld culled", submittedQuads, culledQuads);
+  SM_TRACE("Transient Storage: %llu KB peak, %llu KB committed",
+           (unsigned long long)transientStorage.highWaterMark / 1024,
+           (unsigned long long)transientStorage.committed / 1024);
+  SM_TRACE("Persistent Storage: %llu KB used, %llu KB committed",
+           (unsigned long long)persistentStorage.used / 1024,
+           (unsigned long long)persistentStorage.committed / 1024);
+
+  wait_for_simulation();
+  {
+    std::lock_guard<std::mutex> lock(simulation.mutex);
+    simulation.quit = true;
   }
+  simulation.condition.notify_all();
+  simulation.thread.join();
+  gl_shutdown();
 
   return 0;
 }
@@ -96,46 +256,109 @@ void update_game(GameState* gameStateIn, RenderData* renderDataIn, Input* inputI
   update_game_ptr(gameStateIn ,renderDataIn, inputIn, dt);
 }
 
-double get_delta_time()
+double get_delta_time(double time)
 {
   // Only execute once when entering the function (static)
-  static auto lastTime = std::chrono::steady_clock::now();
-  auto currentTime = std::chrono::steady_clock::now();
+  static double lastTime = time;
 
   // seconds
-  double delta = std::chrono::duration<double>(currentTime - lastTime).count();
-  lastTime = currentTime;
+  double delta = time - lastTime;
+  lastTime = time;
 
   return delta;
 }
 
-void reload_game_dll(BumpAllocator* transientStorage)
+void reload_game_dll()
 {
   static void* gameDLL;
-  static long long lastEditTimestampGameDLL;
 
-  long long currentTimestampGameDLL = get_timestamp("game.dll");
-  if(currentTimestampGameDLL > lastEditTimestampGameDLL)
+  if(!gameDLL || file_changed(gameDLLWatchID))
   {
     if(gameDLL)
     {
       bool freeResult = platform_free_dynamic_library(gameDLL);
-      SM_ASSERT(freeResult, "Failed to free game.dll");
+      SM_ASSERT(freeResult, "Failed to free %s", GAME_DLL_PATH);
       gameDLL = nullptr;
-      SM_TRACE("Freed game.dll");
+      SM_TRACE("Freed %s", GAME_DLL_PATH);
     }
 
-    while(!copy_file("game.dll", "game_load.dll", transientStorage))
+    while(!platform_copy_file((char*)GAME_DLL_PATH, (char*)GAME_LOAD_DLL_PATH))
     {
-      Sleep(10);
+      platform_sleep(10);
     }
-    SM_TRACE("Copied game.dll into game_load.dll");
+    SM_TRACE("Copied %s into %s", GAME_DLL_PATH, GAME_LOAD_DLL_PATH);
 
-    gameDLL = platform_load_dynamic_library("game_load.dll");
-    SM_ASSERT(gameDLL, "Failed to load game.dll");
+    gameDLL = platform_load_dynamic_library((char*)GAME_LOAD_DLL_PATH);
+    SM_ASSERT(gameDLL, "Failed to load %s", GAME_DLL_PATH);
 
     update_game_ptr = (update_game_type*)platform_load_dynamic_function(gameDLL, "update_game");
     SM_ASSERT(update_game_ptr, "Failed to load update_game function");
-    lastEditTimestampGameDLL = currentTimestampGameDLL;
   }
+}
+
+void simulation_thread()
+{
+  while(true)
+  {
+    float dt;
+    {
+      std::unique_lock<std::mutex> lock(simulation.mutex);
+      simulation.condition.wait(lock, []{ return simulation.frameRequested || simulation.quit; });
+      if(simulation.quit)
+      {
+        return;
+      }
+      dt = simulation.dt;
+    }
+
+    RenderData* frameData = renderDataBuffer.write_buffer();
+    update_game(gameState, frameData, simulation.input, dt);
+    sort_instances(frameData);
+
+    // The next buffer can be up to two frames old, only carry over the cameras
+    RenderData* published = renderDataBuffer.publish();
+    RenderData* next = renderDataBuffer.write_buffer();
+    next->gameCamera = published->gameCamera;
+    next->uiCamera = published->uiCamera;
+    // Keeps the packed positions of the next frame close to 0, the camera y is negated
+    next->transformOrigin = {roundf(published->gameCamera.position.x), 
+                             roundf(-published->gameCamera.position.y)};
+    next->transforms.clear();
+    next->uiTransforms.clear();
+    bump_allocator_reset(&next->frameArena);
+    next->cullStats = {};
+
+    {
+      std::lock_guard<std::mutex> lock(simulation.mutex);
+      simulation.frameRequested = false;
+    }
+    simulation.condition.notify_all();
+  }
+}
+
+void start_simulation(double time, float dt)
+{
+  // Hand over the Input Events, the simulation applies them by tick time
+  Input* simInput = simulation.input;
+  simInput->screenSize = input->screenSize;
+  simInput->chunkSavingOff = input->chunkSavingOff;
+  simInput->time = time;
+  simInput->frameStats = framePacer.stats;
+  while(input->events.count())
+  {
+    simInput->events.push(input->events.pop());
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(simulation.mutex);
+    simulation.dt = dt;
+    simulation.frameRequested = true;
+  }
+  simulation.condition.notify_all();
+}
+
+void wait_for_simulation()
+{
+  std::unique_lock<std::mutex> lock(simulation.mutex);
+  simulation.condition.wait(lock, []{ return !simulation.frameRequested; });
 }
\ No newline at end of file
@@ -1,10 +1,45 @@
 #pragma once
 
+#include "breaknotes_lib.h"
+#include "input.h"
+
+// Used to hand file changes from the watcher thread to the main loop
+#include <atomic>
+
+// #############################################################################
+//                           Platform Constants
+// #############################################################################
+constexpr int MAX_WATCHED_FILES = 32; // One bit per file in FileWatcher::changedMask
+
+// #############################################################################
+//                           Platform Structs
+// #############################################################################
+struct WatchedFile
+{
+  char path[256];
+  char directory[256];
+  char* fileName;       // Points into path
+  long long timestamp;  // Owned by the watcher thread after it started
+};
+
+// Files are registered on the main thread before platform_start_file_watcher(),
+// after that the watcher thread only reads the list and posts changes into
+// changedMask. The main loop drains the mask once per frame.
+// Multiple changes to the same file before a drain collapse into one event.
+struct FileWatcher
+{
+  Array<WatchedFile, MAX_WATCHED_FILES> files;
+  std::atomic<unsigned int> changedMask;
+  unsigned int drainedMask; // Main thread only
+  bool started;
+};
+
 // #############################################################################
 //                           Platform Globals
 // #############################################################################
 static bool running = true;
 static KeyCodeID KeyCodeLookupTable[KEY_COUNT];
+static FileWatcher fileWatcher;
 
 // #############################################################################
 //                           Platform Functions
@@ -13,8 +48,67 @@ bool platform_create_window(int width, int height, char* title);
 void platform_update_window();
 void* platform_load_gl_function(char* funName);
 void platform_swap_buffers();
-void platform_set_vsync(bool vSync);
+bool platform_set_vsync(bool vSync);
 void* platform_load_dynamic_library(char* dll);
 void* platform_load_dynamic_function(void* dll, char* funName);
 bool platform_free_dynamic_library(void* dll);
-void platform_fill_keycode_lookup_table();
\ No newline at end of file
+void platform_fill_keycode_lookup_table();
+void platform_sleep(unsigned int ms);
+double platform_get_time();
+bool platform_copy_file(char* fileName, char* outputName);
+bool platform_start_file_watcher();
+
+// #############################################################################
+//                           File Watching
+// #############################################################################
+// Returns the ID used with file_changed()
+int watch_file(const char* filePath)
+{
+  SM_ASSERT(!fileWatcher.started, "Files have to be watched before the watcher starts");
+  SM_ASSERT(strlen(filePath) < ArraySize(WatchedFile::path), "Path too long: %s", filePath);
+
+  WatchedFile file = {};
+  strcpy(file.path, filePath);
+  file.timestamp = get_timestamp(filePath);
+
+  int watchID = fileWatcher.files.add(file);
+
+  // Split into directory and file name, the watchers observe directories
+  // because editors and build scripts replace files instead of writing them
+  WatchedFile* watchedFile = &fileWatcher.files[watchID];
+  char* separator = strrchr(watchedFile->path, '/');
+  if(separator)
+  {
+    memcpy(watchedFile->directory, watchedFile->path, separator - watchedFile->path);
+    watchedFile->fileName = separator + 1;
+  }
+  else
+  {
+    strcpy(watchedFile->directory, ".");
+    watchedFile->fileName = watchedFile->path;
+  }
+
+  return watchID;
+}
+
+// Called from the watcher thread
+void post_file_change(int watchID)
+{
+  fileWatcher.changedMask.fetch_or(BIT(watchID), std::memory_order_release);
+}
+
+// Called once per frame from the main loop
+void drain_file_changes()
+{
+  fileWatcher.drainedMask |= fileWatcher.changedMask.exchange(0, std::memory_order_acquire);
+}
+
+// Returns true once per drained change
+bool file_changed(int watchID)
+{
+  unsigned int bit = BIT(watchID);
+  bool changed = fileWatcher.drainedMask & bit;
+  fileWatcher.drainedMask &= ~bit;
+
+  return changed;
+}
@@ -7,6 +7,12 @@
 #include "breaknotes_lib.h"
 #include "shader_header.h"
 
+// Batched culling, SSE is always available on x64, other targets cull one Transform at a time
+#if defined(__SSE__) || defined(_M_X64)
+#define RENDER_INTERFACE_SSE
+#include <xmmintrin.h>
+#endif
+
 // #############################################################################
 //                           Renderer Constants
 // #############################################################################
@@ -14,9 +20,42 @@
 int RENDER_OPTION_FLIP_X = BIT(0);
 int RENDER_OPTION_FLIP_Y = BIT(1);
 
+constexpr int MAX_MATERIALS = 1024;
+constexpr int MATERIAL_HASH_SLOT_COUNT = MAX_MATERIALS * 2; // Power of 2, half empty
+
+constexpr int MAX_RENDER_LAYERS = 4;
+constexpr int MAX_RENDER_LAYER_INSTANCES = 8192;
+
+constexpr int MAX_TILEMAP_SIZE = 256; // In Tiles, per side
+
+constexpr int INSTANCE_CHUNK_CAPACITY = 1024;
+constexpr size_t FRAME_ARENA_SIZE = MB(64); // Per RenderData, only address space until used
+
+// quad.vert and quad.frag are compiled once per combination, the bits pick the #defines
+constexpr int SHADER_VARIANT_FONT = BIT(0); // VARIANT_FONT, samples the font atlas
+constexpr int SHADER_VARIANT_FLIP = BIT(1); // VARIANT_FLIP, flips the texture coordinates
+constexpr int SHADER_VARIANT_COUNT = 4;
+
 // #############################################################################
 //                           Renderer Structs
 // #############################################################################
+enum RenderPass
+{
+  RENDER_PASS_GAME,
+  RENDER_PASS_UI,
+
+  RENDER_PASS_COUNT
+};
+
+// Translucent quads are blended and drawn after the opaque ones
+enum OpacityClass
+{
+  OPACITY_OPAQUE,
+  OPACITY_TRANSLUCENT,
+
+  OPACITY_CLASS_COUNT
+};
+
 struct OrthographicCamera2D
 {
   float zoom = 1.0f;
@@ -24,13 +63,184 @@ struct OrthographicCamera2D
   Vec2 position;
 };
 
+struct DrawData
+{
+  Material material = {};
+  int renderOptions;
+};
+
+struct TextData
+{
+  Material material = {};
+  float fontSize = 1.0f;
+  int renderOptions;
+};
+
+// Materials are added once and keep their index for the rest of the run.
+// Only the simulation thread adds materials, the renderer reads all
+// materials below `count` and uploads the ones it hasn't seen yet.
+struct MaterialTable
+{
+  Material materials[MAX_MATERIALS];       // Linear colors, uploaded to the GPU
+  Vec4 srgbColors[MAX_MATERIALS];          // Colors as passed in by the game, used for lookup
+  short hashSlots[MATERIAL_HASH_SLOT_COUNT]; // materialIdx + 1, 0 means empty
+  std::atomic<int> count;
+};
+
+// Retained instances, for things that rarely change (like tiles).
+// The game writes them on the simulation thread, the renderer uploads the
+// dirty range while the simulation is idle, see gl_upload_render_layers()
+struct RenderLayer
+{
+  int count;
+  Vec2 origin;    // Instance positions are relative to this, see render_layer_set_origin()
+  int shaderVariant; // Of all instances ever set, the whole layer is one draw call
+  int dirtyStart; // Dirty range [dirtyStart, dirtyEnd), empty if dirtyStart >= dirtyEnd
+  int dirtyEnd;
+  InstanceData instances[MAX_RENDER_LAYER_INSTANCES];
+};
+
+struct RenderLayers
+{
+  int count;
+  RenderLayer layers[MAX_RENDER_LAYERS];
+};
+
+// A grid of tiles drawn as a single quad, the fragment shader looks up the
+// tile in a texture (one texel per tile) and then the sprite in the atlas.
+// Written by the game, uploaded by the renderer like the Render Layers.
+struct TileMap
+{
+  bool active;
+  bool atlasCoordsDirty;
+  IVec2 size;     // In Tiles
+  Vec2 pos;       // Top left corner in the world
+  IVec2 offset;   // Tile (x, y) is stored at (x + offset) % size, see tile_map_scroll()
+  int tileSize;   // In Pixels, same in the world and in the atlas
+  IVec2 dirtyMin; // Dirty rect [dirtyMin, dirtyMax) of the stored tiles
+  IVec2 dirtyMax;
+  IVec2 atlasCoords[MAX_TILEMAP_ATLAS_COORDS]; // Indexed by the tile values
+  unsigned char tiles[MAX_TILEMAP_SIZE * MAX_TILEMAP_SIZE]; // Row major, size.x per row
+};
+
+// Quads that reached the transform arrays vs. quads dropped because they were
+// outside the camera, reset every frame
+struct CullStats
+{
+  int submittedQuads;
+  int culledQuads;
+};
+
+// The part of the world a camera sees
+struct CullRect
+{
+  Vec2 min;
+  Vec2 max;
+};
+
+// Fixed size block of instances, see make_sort_key() for the keys
+struct InstanceChunk
+{
+  InstanceChunk* next;
+  int count;
+  InstanceData instances[INSTANCE_CHUNK_CAPACITY];
+  uint64_t sortKeys[INSTANCE_CHUNK_CAPACITY];
+};
+
+// Instances of a frame, grows one chunk at a time from the frame arena,
+// so nothing is ever copied. The chunks are freed when the arena is reset
+struct InstanceList
+{
+  BumpAllocator* arena;
+  InstanceChunk* first;
+  InstanceChunk* last;
+  int count;
+  int chunkCount;
+
+  void add(InstanceData instance, uint64_t sortKey)
+  {
+    if(!last || last->count == INSTANCE_CHUNK_CAPACITY)
+    {
+      InstanceChunk* chunk = (InstanceChunk*)bump_alloc(arena, sizeof(InstanceChunk));
+      if(!chunk)
+      {
+        return;
+      }
+
+      chunk->next = nullptr;
+      chunk->count = 0;
+      if(last)
+      {
+        last->next = chunk;
+      }
+      else
+      {
+        first = chunk;
+      }
+      last = chunk;
+      chunkCount++;
+    }
+
+    last->sortKeys[last->count] = sortKey;
+    last->instances[last->count++] = instance;
+    count++;
+  }
+
+  void clear()
+  {
+    first = nullptr;
+    last = nullptr;
+    count = 0;
+    chunkCount = 0;
+  }
+};
+
+// Part of RenderData::sortedInstances, drawn with one Shader Variant in one draw call
+struct InstanceBatch
+{
+  int start;
+  int count;
+  int shaderVariant;
+};
+
+// Part of RenderData::sortedBatches
+struct BatchRange
+{
+  int start;
+  int count;
+};
+
+struct Glyph
+{
+  Vec2 offset;
+  Vec2 advance;
+  IVec2 textureCoords;
+  IVec2 size;
+};
 
 struct RenderData
 {
   OrthographicCamera2D gameCamera;      // Camera used to render the game
   OrthographicCamera2D uiCamera;        // Camera used to render the UI
-  Array<Transform, 1000> transforms;     // Array of transforms to render
-  Array<Transform, 1000> uiTransforms;   // Array of transforms to render for the UI
+
+  int fontHeight;
+  Glyph glyphs[127];                    // Indexed by ASCII code, filled by load_font
+
+  MaterialTable* materialTable;             // Shared by all RenderData buffers
+  RenderLayers* renderLayers;               // Shared by all RenderData buffers, drawn after transforms
+  TileMap* tileMap;                         // Shared by all RenderData buffers, drawn after the layers
+  Vec2 transformOrigin;                     // Game transforms are stored relative to this, follows the camera
+  BumpAllocator frameArena;                 // Holds the transforms and uiTransforms, reset with them
+  InstanceList transforms;                  // Transforms to render
+  InstanceList uiTransforms;                // Transforms to render for the UI
+
+  // Both lists ordered by their sort keys, see sort_instances(), null if sorting failed
+  InstanceData* sortedInstances;
+  InstanceBatch* sortedBatches;
+  int sortedBatchCount;
+  BatchRange sortedRanges[RENDER_PASS_COUNT][OPACITY_CLASS_COUNT];
+  CullStats cullStats;                      // Of the transforms and uiTransforms of this frame
+  float currentFps;                         // Copy of the GameState one, safe to read while simulating
 };
 
 // #############################################################################
@@ -53,38 +263,339 @@ IVec2 screen_to_world(IVec2 screenPos)
 
   int yPos = (float)screenPos.y / (float)input->screenSize.y * camera.dimensions.y;
 
-  // Offset using dimensions and position
-  yPos += camera.dimensions.y / 2.0f + camera.position.y;
+  // Offset using dimensions and position, the camera y is negated
+  yPos += -camera.dimensions.y / 2.0f - camera.position.y;
 
   return {xPos, yPos};
 }
 
+unsigned int hash_color(Vec4 color)
+{
+  // FNV-1a over the bytes of the color
+  unsigned int hash = 2166136261u;
+  unsigned char* bytes = (unsigned char*)color.values;
+  for(int byteIdx = 0; byteIdx < sizeof(color.values); byteIdx++)
+  {
+    hash = (hash ^ bytes[byteIdx]) * 16777619u;
+  }
+
+  return hash;
+}
+
 int get_material_idx(Material material = {})
 {
+  MaterialTable* materialTable = renderData->materialTable;
+  int count = materialTable->count.load(std::memory_order_relaxed);
+
+  // Linear probing, the table is never more than half full
+  unsigned int slotIdx = hash_color(material.color) & (MATERIAL_HASH_SLOT_COUNT - 1);
+  while(int materialIdx = materialTable->hashSlots[slotIdx])
+  {
+    if(materialTable->srgbColors[materialIdx - 1] == material.color)
+    {
+      return materialIdx - 1;
+    }
+    slotIdx = (slotIdx + 1) & (MATERIAL_HASH_SLOT_COUNT - 1);
+  }
+
+  if(count >= MAX_MATERIALS)
+  {
+    SM_ASSERT(false, "Material Table is full");
+    return 0;
+  }
+
   // convert from SRGB to linear color space, to be used in the shader
+  materialTable->srgbColors[count] = material.color;
   material.color.r = powf(material.color.r, 2.2f);
   material.color.g = powf(material.color.g, 2.2f);
   material.color.b = powf(material.color.b, 2.2f);
-  material.color.a = powf(material.color.a, 2.2f);
+  materialTable->materials[count] = material;
+  materialTable->hashSlots[slotIdx] = count + 1;
+
+  // Publish the Material to the renderer
+  materialTable->count.store(count + 1, std::memory_order_release);
+
+  return count;
+}
 
-  for (int materialIdx = 0; materialIdx < renderData->materials.count; materialIdx++)
+// Clamps into the 16 Bit range, quads that far out are off screen anyway
+uint pack_16(int x, int y, int minValue, int maxValue)
+{
+  x = x < minValue? minValue : (x > maxValue? maxValue : x);
+  y = y < minValue? minValue : (y > maxValue? maxValue : y);
+
+  return ((uint)x & 0xFFFF) | ((uint)y << 16);
+}
+
+// roundf() is a library call without SSE4.1, this is inlined
+int round_to_int(float x)
+{
+  return (int)(x + (x < 0.0f? -0.5f : 0.5f));
+}
+
+PackedTransform pack_transform(Transform transform)
+{
+  float scale = (float)(1 << TRANSFORM_FRACTION_BITS);
+  float layer = transform.layer < 0.0f? 0.0f : (transform.layer > 1.0f? 1.0f : transform.layer);
+
+  PackedTransform packed = {};
+  packed.pos = pack_16(round_to_int(transform.pos.x * scale), 
+                       round_to_int(transform.pos.y * scale), INT16_MIN, INT16_MAX);
+  packed.size = pack_16(round_to_int(transform.size.x * scale), 
+                        round_to_int(transform.size.y * scale), 0, UINT16_MAX);
+  packed.atlasOffset = pack_16(transform.atlasOffset.x, transform.atlasOffset.y, 0, UINT16_MAX);
+  packed.spriteSize = pack_16(transform.spriteSize.x, transform.spriteSize.y, 0, UINT16_MAX);
+  packed.packedData = ((uint)transform.renderOptions & 0xFF) | 
+                      ((uint)round_to_int(layer * 255.0f) << 8) |
+                      ((uint)transform.materialIdx << 16);
+
+  return packed;
+}
+
+// Positions are stored relative to origin, the packed positions only
+// reach +-4096 pixels, the vertex shader adds the origin back
+InstanceData encode_transform(Transform transform, Vec2 origin)
+{
+  transform.pos = transform.pos - origin;
+
+#ifdef COMPACT_TRANSFORMS
+  return pack_transform(transform);
+#else
+  return transform;
+#endif
+}
+
+// Flip flags of fonts and sprites need the same variant, everything else needs none
+int get_shader_variant(int renderOptions)
+{
+  int shaderVariant = 0;
+  if(renderOptions & RENDERING_OPTION_FONT)
+  {
+    shaderVariant |= SHADER_VARIANT_FONT;
+  }
+  if(renderOptions & (RENDERING_OPTION_FLIP_X | RENDERING_OPTION_FLIP_Y))
   {
-    if(renderData->materials[materialIdx] == material)
+    shaderVariant |= SHADER_VARIANT_FLIP;
+  }
+
+  return shaderVariant;
+}
+
+int get_shader_variant(InstanceData instance)
+{
+#ifdef COMPACT_TRANSFORMS
+  return get_shader_variant((int)(instance.packedData & 0xFF));
+#else
+  return get_shader_variant(instance.renderOptions);
+#endif
+}
+
+// #############################################################################
+//                           Sort Keys
+// #############################################################################
+// 63      Render Pass
+// 62      Translucent, opaque quads come first
+// 60..61  Shader Variant, opaque only, one draw call per variant
+// 52..59  Layer, opaque front to back for early depth rejection, translucent back to front
+// 42..51  Material, opaque only, translucent quads keep the call order within a layer
+// 30..41  Atlas position, opaque only
+// 0..29   Index into the InstanceList, keeps the order of equal keys
+uint64_t make_sort_key(RenderPass pass, Transform transform, int instanceIdx)
+{
+  MaterialTable* materialTable = renderData->materialTable;
+  bool isTranslucent = transform.materialIdx < materialTable->count.load(std::memory_order_relaxed) &&
+                       materialTable->srgbColors[transform.materialIdx].a < 1.0f;
+  float layer = transform.layer < 0.0f? 0.0f : (transform.layer > 1.0f? 1.0f : transform.layer);
+  uint64_t layerKey = (uint64_t)round_to_int(layer * 255.0f);
+
+  uint64_t sortKey = ((uint64_t)pass << 63) | ((uint64_t)isTranslucent << 62) | 
+                     ((uint32_t)instanceIdx & 0x3FFFFFFF);
+  if(isTranslucent)
+  {
+    sortKey |= layerKey << 52;
+  }
+  else
+  {
+    uint64_t atlasKey = ((transform.atlasOffset.y >> 3) & 0x3F) << 6 | ((transform.atlasOffset.x >> 3) & 0x3F);
+    sortKey |= (uint64_t)get_shader_variant(transform.renderOptions) << 60;
+    sortKey |= (255 - layerKey) << 52;
+    sortKey |= ((uint64_t)transform.materialIdx & 0x3FF) << 42;
+    sortKey |= atlasKey << 30;
+  }
+
+  return sortKey;
+}
+
+// Orders the instances of both passes by their sort keys into sortedInstances and
+// splits them into batches, called on the simulation thread once the frame is complete
+void sort_instances(RenderData* frameData)
+{
+  frameData->sortedInstances = nullptr;
+  frameData->sortedBatches = nullptr;
+  frameData->sortedBatchCount = 0;
+  memset(frameData->sortedRanges, 0, sizeof(frameData->sortedRanges));
+
+  InstanceList* lists[RENDER_PASS_COUNT] = {&frameData->transforms, &frameData->uiTransforms};
+  int count = lists[RENDER_PASS_GAME]->count + lists[RENDER_PASS_UI]->count;
+  if(!count)
+  {
+    return;
+  }
+
+  BumpAllocator* arena = &frameData->frameArena;
+  uint64_t* keys = (uint64_t*)bump_alloc(arena, sizeof(uint64_t) * count);
+  uint64_t* temp = (uint64_t*)bump_alloc(arena, sizeof(uint64_t) * count);
+  InstanceData* sortedInstances = (InstanceData*)bump_alloc(arena, sizeof(InstanceData) * count);
+  InstanceBatch* sortedBatches = (InstanceBatch*)bump_alloc(arena, sizeof(InstanceBatch) * count);
+  InstanceChunk** chunks[RENDER_PASS_COUNT] = {};
+  for(int pass = 0; pass < RENDER_PASS_COUNT; pass++)
+  {
+    chunks[pass] = (InstanceChunk**)bump_alloc(arena, sizeof(InstanceChunk*) * (lists[pass]->chunkCount + 1));
+  }
+  if(!keys || !temp || !sortedInstances || !sortedBatches || !chunks[RENDER_PASS_GAME] || !chunks[RENDER_PASS_UI])
+  {
+    SM_WARN("Frame Arena is full, drawing %d Instances unsorted", count);
+    return;
+  }
+
+  // The keys only hold the index, so the chunks need to be found by index
+  int keyCount = 0;
+  for(int pass = 0; pass < RENDER_PASS_COUNT; pass++)
+  {
+    int chunkIdx = 0;
+    for(InstanceChunk* chunk = lists[pass]->first; chunk; chunk = chunk->next)
     {
-      return materialIdx;
+      chunks[pass][chunkIdx++] = chunk;
+      memcpy(&keys[keyCount], chunk->sortKeys, sizeof(uint64_t) * chunk->count);
+      keyCount += chunk->count;
     }
   }
 
-  return renderData->materials.add(material);
+  keys = radix_sort(keys, temp, count);
+
+  // A new batch starts whenever the pass, opacity class or variant changes.
+  // Opaque variants are grouped by the key, translucent ones only in runs
+  int batchCount = 0;
+  for(int idx = 0; idx < count; idx++)
+  {
+    uint64_t sortKey = keys[idx];
+    int pass = (int)(sortKey >> 63);
+    int opacityClass = (int)((sortKey >> 62) & 1);
+    uint32_t instanceIdx = (uint32_t)(sortKey & 0x3FFFFFFF);
+
+    InstanceChunk* chunk = chunks[pass][instanceIdx / INSTANCE_CHUNK_CAPACITY];
+    InstanceData instance = chunk->instances[instanceIdx % INSTANCE_CHUNK_CAPACITY];
+    sortedInstances[idx] = instance;
+
+    int shaderVariant = get_shader_variant(instance);
+    BatchRange* range = &frameData->sortedRanges[pass][opacityClass];
+    if(!range->count || sortedBatches[batchCount - 1].shaderVariant != shaderVariant)
+    {
+      if(!range->count)
+      {
+        range->start = batchCount;
+      }
+      sortedBatches[batchCount++] = {idx, 0, shaderVariant};
+      range->count++;
+    }
+    sortedBatches[batchCount - 1].count++;
+  }
+
+  frameData->sortedInstances = sortedInstances;
+  frameData->sortedBatches = sortedBatches;
+  frameData->sortedBatchCount = batchCount;
+}
+
+// #############################################################################
+//                           Culling
+// #############################################################################
+CullRect get_cull_rect(OrthographicCamera2D camera)
+{
+  // The camera y is negated
+  Vec2 center = {camera.position.x, -camera.position.y};
+  Vec2 halfDimensions = camera.dimensions / 2.0f;
+
+  CullRect cullRect = {};
+  cullRect.min = {center.x - halfDimensions.x, center.y - halfDimensions.y};
+  cullRect.max = {center.x + halfDimensions.x, center.y + halfDimensions.y};
+
+  return cullRect;
+}
+
+// Quads only touching the edge are outside
+bool is_in_view(CullRect cullRect, Transform transform)
+{
+  return transform.pos.x < cullRect.max.x && transform.pos.x + transform.size.x > cullRect.min.x &&
+         transform.pos.y < cullRect.max.y && transform.pos.y + transform.size.y > cullRect.min.y;
+}
+
+// Appends the Transforms inside cullRect to instances, the SSE path tests
+// 4 Transforms at a time, the rest goes through is_in_view()
+void add_visible_transforms(InstanceList* instances, RenderPass pass, CullRect cullRect, Vec2 origin,
+                            Transform* transforms, int count)
+{
+  int startCount = instances->count;
+  int idx = 0;
+
+#ifdef RENDER_INTERFACE_SSE
+  __m128 minX = _mm_set1_ps(cullRect.min.x);
+  __m128 minY = _mm_set1_ps(cullRect.min.y);
+  __m128 maxX = _mm_set1_ps(cullRect.max.x);
+  __m128 maxY = _mm_set1_ps(cullRect.max.y);
+  for(; idx + 4 <= count; idx += 4)
+  {
+    Transform* t = &transforms[idx];
+    __m128 left = _mm_setr_ps(t[0].pos.x, t[1].pos.x, t[2].pos.x, t[3].pos.x);
+    __m128 top = _mm_setr_ps(t[0].pos.y, t[1].pos.y, t[2].pos.y, t[3].pos.y);
+    __m128 right = _mm_add_ps(left, _mm_setr_ps(t[0].size.x, t[1].size.x, t[2].size.x, t[3].size.x));
+    __m128 bottom = _mm_add_ps(top, _mm_setr_ps(t[0].size.y, t[1].size.y, t[2].size.y, t[3].size.y));
+
+    __m128 insideX = _mm_and_ps(_mm_cmplt_ps(left, maxX), _mm_cmpgt_ps(right, minX));
+    __m128 insideY = _mm_and_ps(_mm_cmplt_ps(top, maxY), _mm_cmpgt_ps(bottom, minY));
+    int insideMask = _mm_movemask_ps(_mm_and_ps(insideX, insideY));
+    for(int lane = 0; lane < 4; lane++)
+    {
+      if(insideMask & BIT(lane))
+      {
+        instances->add(encode_transform(t[lane], origin), make_sort_key(pass, t[lane], instances->count));
+      }
+    }
+  }
+#endif
+
+  for(; idx < count; idx++)
+  {
+    if(is_in_view(cullRect, transforms[idx]))
+    {
+      instances->add(encode_transform(transforms[idx], origin), 
+                     make_sort_key(pass, transforms[idx], instances->count));
+    }
+  }
+
+  int submittedCount = instances->count - startCount;
+  renderData->cullStats.submittedQuads += submittedCount;
+  renderData->cullStats.culledQuads += count - submittedCount;
 }
 
 // #############################################################################
 //                           Renderer Functions
 // #############################################################################
+// For emitters with many quads at once, they are culled in batches
+void draw_quads(Transform* transforms, int count)
+{
+  add_visible_transforms(&renderData->transforms, RENDER_PASS_GAME, get_cull_rect(renderData->gameCamera),
+                         renderData->transformOrigin, transforms, count);
+}
+
+void draw_ui_quads(Transform* transforms, int count)
+{
+  add_visible_transforms(&renderData->uiTransforms, RENDER_PASS_UI, get_cull_rect(renderData->uiCamera), 
+                         {}, transforms, count);
+}
 
 void draw_quad(Transform  transform)
 {
-  renderData->transforms.add(transform);
+  draw_quads(&transform, 1);
 }
 
 void draw_quad(Vec2 pos, Vec2 size)
@@ -95,7 +606,7 @@ void draw_quad(Vec2 pos, Vec2 size)
   transform.atlasOffset = {0, 0};
   transform.spriteSize = {1, 1};
 
-  renderData->transforms.add(transform);
+  draw_quads(&transform, 1);
 }
 
 void draw_sprite(SpriteID spriteID, Vec2 pos, DrawData drawData = {})
@@ -110,7 +621,7 @@ void draw_sprite(SpriteID spriteID, Vec2 pos, DrawData drawData = {})
   transform.spriteSize = sprite.spriteSize;
   transform.renderOptions = drawData.renderOptions;
 
-  renderData->transforms.add(transform);
+  draw_quads(&transform, 1);
 }
 
 void draw_sprite(SpriteID spriteID, IVec2 pos, DrawData drawData = {})
@@ -118,6 +629,134 @@ void draw_sprite(SpriteID spriteID, IVec2 pos, DrawData drawData = {})
   draw_sprite(spriteID, vec_2(pos), drawData);
 }
 
+// #############################################################################
+//                           Render Layers
+// #############################################################################
+// Returns the ID used by the other render_layer functions, layers live
+// for the whole run, so store the ID in the GameState
+int create_render_layer(int instanceCount)
+{
+  RenderLayers* renderLayers = renderData->renderLayers;
+  SM_ASSERT(renderLayers->count < MAX_RENDER_LAYERS, "Too many Render Layers");
+  SM_ASSERT(instanceCount <= MAX_RENDER_LAYER_INSTANCES, "Render Layer too big: %d", instanceCount);
+
+  int layerID = renderLayers->count++;
+  RenderLayer* layer = &renderLayers->layers[layerID];
+  layer->count = instanceCount;
+  layer->dirtyStart = 0;
+  layer->dirtyEnd = instanceCount;
+
+  return layerID;
+}
+
+// Only marks the instance dirty if it actually changed
+void render_layer_set(int layerID, int instanceIdx, Transform transform)
+{
+  RenderLayer* layer = &renderData->renderLayers->layers[layerID];
+  SM_ASSERT(instanceIdx >= 0 && instanceIdx < layer->count, "Instance out of bounds: %d", instanceIdx);
+
+  SM_ASSERT(!(transform.renderOptions & RENDERING_OPTION_FONT), "Render Layers can't hold text");
+  layer->shaderVariant |= get_shader_variant(transform.renderOptions);
+
+  InstanceData instance = encode_transform(transform, layer->origin);
+  if(memcmp(&layer->instances[instanceIdx], &instance, sizeof(InstanceData)) == 0)
+  {
+    return;
+  }
+
+  layer->instances[instanceIdx] = instance;
+  if(layer->dirtyStart >= layer->dirtyEnd)
+  {
+    layer->dirtyStart = instanceIdx;
+    layer->dirtyEnd = instanceIdx + 1;
+  }
+  else
+  {
+    layer->dirtyStart = instanceIdx < layer->dirtyStart? instanceIdx : layer->dirtyStart;
+    layer->dirtyEnd = instanceIdx + 1 > layer->dirtyEnd? instanceIdx + 1 : layer->dirtyEnd;
+  }
+}
+
+// Hidden instances keep their slot, they are just drawn with a size of 0
+void render_layer_hide(int layerID, int instanceIdx)
+{
+  // Encodes to all zeros, like the instances of a new layer
+  Transform transform = {};
+  transform.pos = renderData->renderLayers->layers[layerID].origin;
+  render_layer_set(layerID, instanceIdx, transform);
+}
+
+// Only affects instances set afterwards, so set the origin before refilling the layer
+void render_layer_set_origin(int layerID, Vec2 origin)
+{
+  renderData->renderLayers->layers[layerID].origin = origin;
+}
+
+// #############################################################################
+//                           Tile Map
+// #############################################################################
+// All tiles start out empty
+void create_tile_map(IVec2 size, int tileSize, Vec2 pos, IVec2* atlasCoords, int atlasCoordCount)
+{
+  SM_ASSERT(size.x <= MAX_TILEMAP_SIZE && size.y <= MAX_TILEMAP_SIZE, 
+            "Tile Map too big: %dx%d", size.x, size.y);
+  SM_ASSERT(atlasCoordCount <= MAX_TILEMAP_ATLAS_COORDS, "Too many Atlas Coords: %d", atlasCoordCount);
+
+  TileMap* tileMap = renderData->tileMap;
+  tileMap->active = true;
+  tileMap->size = size;
+  tileMap->tileSize = tileSize;
+  tileMap->pos = pos;
+  memcpy(tileMap->atlasCoords, atlasCoords, sizeof(IVec2) * atlasCoordCount);
+  tileMap->atlasCoordsDirty = true;
+  tileMap->offset = {};
+  memset(tileMap->tiles, TILEMAP_EMPTY_TILE, size.x * size.y);
+  tileMap->dirtyMin = {};
+  tileMap->dirtyMax = size;
+}
+
+// tileValue indexes the atlas coords, TILEMAP_EMPTY_TILE hides the tile
+void tile_map_set(int x, int y, int tileValue)
+{
+  TileMap* tileMap = renderData->tileMap;
+  SM_ASSERT(x >= 0 && x < tileMap->size.x && y >= 0 && y < tileMap->size.y, 
+            "Tile out of bounds: %d, %d", x, y);
+
+  int storedX = (x + tileMap->offset.x) % tileMap->size.x;
+  int storedY = (y + tileMap->offset.y) % tileMap->size.y;
+  unsigned char* tile = &tileMap->tiles[storedY * tileMap->size.x + storedX];
+  if(*tile == tileValue)
+  {
+    return;
+  }
+
+  *tile = tileValue;
+  if(tileMap->dirtyMin.x >= tileMap->dirtyMax.x)
+  {
+    tileMap->dirtyMin = {storedX, storedY};
+    tileMap->dirtyMax = {storedX + 1, storedY + 1};
+  }
+  else
+  {
+    tileMap->dirtyMin.x = storedX < tileMap->dirtyMin.x? storedX : tileMap->dirtyMin.x;
+    tileMap->dirtyMin.y = storedY < tileMap->dirtyMin.y? storedY : tileMap->dirtyMin.y;
+    tileMap->dirtyMax.x = storedX + 1 > tileMap->dirtyMax.x? storedX + 1 : tileMap->dirtyMax.x;
+    tileMap->dirtyMax.y = storedY + 1 > tileMap->dirtyMax.y? storedY + 1 : tileMap->dirtyMax.y;
+  }
+}
+
+// Moves the map by whole tiles without moving the stored tiles, the ones that
+// stay on the map keep their texel. The tiles that scrolled onto the map still
+// hold what scrolled off, set them again
+void tile_map_scroll(int tilesX, int tilesY)
+{
+  TileMap* tileMap = renderData->tileMap;
+  tileMap->pos.x += (float)(tilesX * tileMap->tileSize);
+  tileMap->pos.y += (float)(tilesY * tileMap->tileSize);
+  tileMap->offset.x = ((tileMap->offset.x + tilesX) % tileMap->size.x + tileMap->size.x) % tileMap->size.x;
+  tileMap->offset.y = ((tileMap->offset.y + tilesY) % tileMap->size.y + tileMap->size.y) % tileMap->size.y;
+}
+
 // #############################################################################
 //                     Render Interface UI Font Rendering
 // #############################################################################
@@ -130,9 +769,21 @@ void draw_ui_text(char* text, Vec2 pos, TextData textData = {})
     return;
   }
 
+  int materialIdx = get_material_idx(textData.material);
+
+  // Glyphs are culled in batches
+  Transform glyphTransforms[64];
+  int glyphCount = 0;
+
   Vec2 origin = pos;
   while(char c = *(text++))
   {
+    if(glyphCount == ArraySize(glyphTransforms))
+    {
+      draw_ui_quads(glyphTransforms, glyphCount);
+      glyphCount = 0;
+    }
+
     if(c == '\n')
     {
       pos.x = origin.x;
@@ -142,7 +793,7 @@ void draw_ui_text(char* text, Vec2 pos, TextData textData = {})
 
     Glyph glyph = renderData->glyphs[c];
     Transform transform = {};
-    transform.materialIdx = get_material_idx(textData.material);
+    transform.materialIdx = materialIdx;
     transform.pos.x = pos.x + glyph.offset.x * textData.fontSize;
     transform.pos.y = pos.y + glyph.offset.y * textData.fontSize;
     transform.atlasOffset = glyph.textureCoords;
@@ -150,11 +801,13 @@ void draw_ui_text(char* text, Vec2 pos, TextData textData = {})
     transform.size = vec_2(glyph.size) * textData.fontSize;
     transform.renderOptions = textData.renderOptions | RENDERING_OPTION_FONT;
 
-    renderData->uiTransforms.add(transform);
+    glyphTransforms[glyphCount++] = transform;
 
     // Advance the Glyph
     pos.x += glyph.advance.x * textData.fontSize;
   }
+
+  draw_ui_quads(glyphTransforms, glyphCount);
 }
 
 template <typename... Args>
@@ -5,6 +5,7 @@
 #define vec2 Vec2
 #define ivec2 IVec2
 #define vec4 Vec4
+typedef unsigned int uint;
 
 // Inside Shader
 #else 
@@ -14,6 +15,15 @@
 // Inside Both
 #endif 
 
+// Instances are uploaded as PackedTransform (20 Bytes) instead of Transform (48 Bytes)
+#define COMPACT_TRANSFORMS
+
+#ifdef COMPACT_TRANSFORMS
+#define InstanceData PackedTransform
+#else
+#define InstanceData Transform
+#endif
+
 // #############################################################################
 //                           Rendering Constants
 // #############################################################################
@@ -21,6 +31,14 @@ int RENDERING_OPTION_FLIP_X = BIT(0);
 int RENDERING_OPTION_FLIP_Y = BIT(1);
 int RENDERING_OPTION_FONT = BIT(2);
 
+// Fixed Point Positions and Sizes of PackedTransform, 1/8th of a Pixel
+// Positions range from -4096 to 4096, Sizes up to 8192
+int TRANSFORM_FRACTION_BITS = 3;
+
+// Tile Maps, macros because they are used as array sizes
+#define MAX_TILEMAP_ATLAS_COORDS 32 // Tile values index into the atlas coordinates
+#define TILEMAP_EMPTY_TILE 255
+
 // #############################################################################
 //                           Rendering Structs
 // #############################################################################
@@ -54,4 +72,14 @@ struct Material
   vec4 color;
 
 #endif
-};
\ No newline at end of file
+};
+
+// Quantized Transform, two 16 bit values per uint
+struct PackedTransform
+{
+  uint pos;          // Signed Fixed Point x | y << 16
+  uint size;         // Unsigned Fixed Point x | y << 16
+  uint atlasOffset;  // x | y << 16
+  uint spriteSize;   // x | y << 16
+  uint packedData;   // renderOptions (8 Bits) | layer (8 Bits) << 8 | materialIdx << 16
+};
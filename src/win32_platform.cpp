@@ -8,7 +8,9 @@
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <windows.h>
+#include <timeapi.h>
 #include "../third_party/wglext.h"
+#include <thread>
 
 // #############################################################################
 //                           Windows Globals
@@ -20,6 +22,14 @@ static PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT_ptr;
 // #############################################################################
 //                           Platform Implementations
 // #############################################################################
+// When the message currently being handled was posted
+double win32_message_time()
+{
+  // GetMessageTime() is in milliseconds on the GetTickCount() clock
+  LONG messageAge = (LONG)(GetTickCount() - (DWORD)GetMessageTime());
+  return platform_get_time() - messageAge / 1000.0;
+}
+
 LRESULT CALLBACK windows_window_callback(HWND window, UINT msg,
                                          WPARAM wParam, LPARAM lParam)
 {
@@ -52,11 +62,7 @@ LRESULT CALLBACK windows_window_callback(HWND window, UINT msg,
                     (msg == WM_LBUTTONDOWN);
 
       KeyCodeID keyCode = KeyCodeLookupTable[wParam];
-      Key* key = &input->keys[keyCode];
-      key->justPressed = !key->justPressed && !key->isDown && isDown;
-      key->justReleased = !key->justReleased && key->isDown && !isDown;
-      key->isDown = isDown;
-      key->halfTransitionCount++;
+      push_key_event(win32_message_time(), keyCode, isDown);
 
       break;
     }
@@ -74,11 +80,7 @@ LRESULT CALLBACK windows_window_callback(HWND window, UINT msg,
         (msg == WM_MBUTTONDOWN || msg == WM_MBUTTONUP)? VK_MBUTTON: VK_RBUTTON;
 
       KeyCodeID keyCode = KeyCodeLookupTable[mouseCode];
-      Key* key = &input->keys[keyCode];
-      key->justPressed = !key->justPressed && !key->isDown && isDown;
-      key->justReleased = !key->justReleased && key->isDown && !isDown;
-      key->isDown = isDown;
-      key->halfTransitionCount++;
+      push_key_event(win32_message_time(), keyCode, isDown);
 
       break;
     }
@@ -297,6 +299,9 @@ bool platform_create_window(int width, int height, char* title)
 
   ShowWindow(window, SW_SHOW);
 
+  // Sleep() is accurate to 1ms instead of ~15ms, needed for frame pacing
+  timeBeginPeriod(1);
+
   return true;
 }
 
@@ -317,8 +322,12 @@ void platform_update_window()
     GetCursorPos(&point);
     ScreenToClient(window, &point);
 
-    input->mousePos.x = point.x;
-    input->mousePos.y = point.y;
+    IVec2 mousePos = {point.x, point.y};
+    if(mousePos.x != input->mousePos.x || mousePos.y != input->mousePos.y)
+    {
+      push_mouse_event(platform_get_time(), mousePos);
+    }
+    input->mousePos = mousePos;
 
     // Mouse Position World
     input->mousePosWorld = screen_to_world(input->mousePos);
@@ -349,9 +358,14 @@ void platform_swap_buffers()
   SwapBuffers(dc);
 }
 
-void platform_set_vsync(bool vSync)
+bool platform_set_vsync(bool vSync)
 {
-  wglSwapIntervalEXT_ptr(vSync);
+  if(!wglSwapIntervalEXT_ptr)
+  {
+    return false;
+  }
+
+  return wglSwapIntervalEXT_ptr(vSync);
 }
 
 void* platform_load_dynamic_library(char* dll)
@@ -378,6 +392,110 @@ bool platform_free_dynamic_library(void* dll)
   return (bool)freeResult;
 }
 
+void platform_sleep(unsigned int ms)
+{
+  Sleep(ms);
+}
+
+double platform_get_time()
+{
+  static LARGE_INTEGER frequency;
+  static LARGE_INTEGER startCounter;
+  if(!frequency.QuadPart)
+  {
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&startCounter);
+  }
+
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+
+  return (double)(counter.QuadPart - startCounter.QuadPart) / (double)frequency.QuadPart;
+}
+
+bool platform_copy_file(char* fileName, char* outputName)
+{
+  // Copies inside the OS, the data never goes through our memory
+  BOOL copyResult = CopyFileA(fileName, outputName, FALSE);
+  if(!copyResult)
+  {
+    SM_ERROR("Failed copying File: %s into %s", fileName, outputName);
+  }
+
+  return (bool)copyResult;
+}
+
+void win32_file_watcher_thread(HANDLE* changeHandles, int* directoryIDs, int directoryCount)
+{
+  while(true)
+  {
+    DWORD waitResult = WaitForMultipleObjects(directoryCount, changeHandles, FALSE, INFINITE);
+    int directoryID = waitResult - WAIT_OBJECT_0;
+    if(directoryID < 0 || directoryID >= directoryCount)
+    {
+      SM_ERROR("File Watcher stopped");
+      return;
+    }
+
+    // Windows only tells us that something in the directory changed
+    for(int watchID = 0; watchID < fileWatcher.files.count; watchID++)
+    {
+      WatchedFile* file = &fileWatcher.files[watchID];
+      long long timestamp = get_timestamp(file->path);
+      if(directoryIDs[watchID] == directoryID && timestamp > file->timestamp)
+      {
+        file->timestamp = timestamp;
+        post_file_change(watchID);
+      }
+    }
+
+    FindNextChangeNotification(changeHandles[directoryID]);
+  }
+}
+
+bool platform_start_file_watcher()
+{
+  static HANDLE changeHandles[MAX_WATCHED_FILES];
+  static int directoryIDs[MAX_WATCHED_FILES];
+  int directoryCount = 0;
+
+  for(int watchID = 0; watchID < fileWatcher.files.count; watchID++)
+  {
+    WatchedFile* file = &fileWatcher.files[watchID];
+
+    // Only watch every directory once
+    directoryIDs[watchID] = -1;
+    for(int prevID = 0; prevID < watchID; prevID++)
+    {
+      if(strcmp(fileWatcher.files[prevID].directory, file->directory) == 0)
+      {
+        directoryIDs[watchID] = directoryIDs[prevID];
+        break;
+      }
+    }
+
+    if(directoryIDs[watchID] == -1)
+    {
+      HANDLE changeHandle = FindFirstChangeNotificationA(file->directory, FALSE,
+                                                         FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                                         FILE_NOTIFY_CHANGE_FILE_NAME);
+      if(changeHandle == INVALID_HANDLE_VALUE)
+      {
+        SM_ERROR("Failed to watch: %s", file->path);
+        return false;
+      }
+
+      changeHandles[directoryCount] = changeHandle;
+      directoryIDs[watchID] = directoryCount++;
+    }
+  }
+
+  fileWatcher.started = true;
+  std::thread(win32_file_watcher_thread, changeHandles, directoryIDs, directoryCount).detach();
+
+  return true;
+}
+
 void platform_fill_keycode_lookup_table()
 {
   KeyCodeLookupTable[VK_LBUTTON] = KEY_MOUSE_LEFT;